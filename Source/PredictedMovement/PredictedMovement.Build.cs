@@ -12,6 +12,7 @@ public class PredictedMovement : ModuleRules
 			new string[]
 			{
 				"Core",
+				"TraceLog",
 			}
 			);
 		
@@ -7,6 +7,7 @@
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
 #include "PredictedMovement/Public/Modifier/ModifierMovement.h"
+#include "System/PredictedMovementSignificance.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(ModifierCharacter)
 
@@ -15,6 +16,18 @@ AModifierCharacter::AModifierCharacter(const FObjectInitializer& FObjectInitiali
 	: Super(FObjectInitializer.SetDefaultSubobjectClass<UModifierMovement>(CharacterMovementComponentName))
 {
 	ModifierMovement = Cast<UModifierMovement>(GetCharacterMovement());
+
+	// One level per registered family
+	if (ModifierMovement)
+	{
+		const int32 NumFamilies = ModifierMovement->GetModifierRegistry().Families.Num();
+		SimulatedModifierLevels.Init(NO_MODIFIER, NumFamilies);
+		SimulatedCustomModifierLevels.Init(NO_MODIFIER, FMath::Max(0, NumFamilies - static_cast<int32>(EModifierType::Num)));
+		for (int32 i = 0; i < NumFamilies; ++i)
+		{
+			SimulatedState.SetLevel(i, NO_MODIFIER);
+		}
+	}
 }
 
 void AModifierCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -24,48 +37,252 @@ void AModifierCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 	// Push Model
 	FDoRepLifetimeParams SharedParams;
 	SharedParams.bIsPushBased = true;
-	SharedParams.Condition = COND_SimulatedOnly;
-	
+	SharedParams.Condition = bReplicatePackedSimulatedState ? COND_Never : COND_SimulatedOnly;
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SimulatedBoost, SharedParams);
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SimulatedSnare, SharedParams);
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SimulatedSlowFall, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SimulatedCustomModifierLevels, SharedParams);
+
+	// Packed alternative, only one of these is ever replicated
+	FDoRepLifetimeParams PackedParams;
+	PackedParams.bIsPushBased = true;
+	PackedParams.Condition = bReplicatePackedSimulatedState ? COND_SimulatedOnly : COND_Never;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SimulatedState, PackedParams);
+
+	// Autonomous proxies need to verify the tables too
+	FDoRepLifetimeParams ChecksumParams;
+	ChecksumParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ModifierTableChecksum, ChecksumParams);
+}
+
+void AModifierCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Send the server's level table checksum with the initial replication
+	if (ModifierMovement && HasAuthority())
+	{
+		ModifierTableChecksum = ModifierMovement->GetModifierTableChecksum();
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ModifierTableChecksum, this);
+	}
 }
 
-void AModifierCharacter::OnModifierChanged(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel,
-	const FGameplayTag& PrevModifierLevel)
+void AModifierCharacter::OnRep_ModifierTableChecksum()
 {
+	if (ModifierMovement)
+	{
+		ModifierMovement->VerifyModifierTableChecksum(ModifierTableChecksum);
+	}
+}
+
+void AModifierCharacter::OnModifierChanged(int32 FamilyIndex, const FGameplayTag& ModifierType,
+	const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel)
+{
+	PRAGMA_DISABLE_DEPRECATION_WARNINGS
+	OnModifierChanged(ModifierType, ModifierLevel, PrevModifierLevel);
+	PRAGMA_ENABLE_DEPRECATION_WARNINGS
+
 	K2_OnModifierChanged(ModifierType, ModifierLevel, PrevModifierLevel);
 
 	// Replicate to simulated proxies
 	if (ModifierMovement && HasAuthority())
 	{
-		if (ModifierType == FModifierTags::Modifier_Boost)
+		const FModifierRegistry& Registry = ModifierMovement->GetModifierRegistry();
+		if (Registry.Families.IsValidIndex(FamilyIndex))
 		{
-			SimulatedBoost = ModifierMovement->GetBoostLevelIndex(ModifierLevel);
-			MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedBoost, this);
+			const uint8 Level = *Registry.Families[FamilyIndex].Level;
+			if (!SimulatedModifierLevels.IsValidIndex(FamilyIndex))
+			{
+				SimulatedModifierLevels.SetNum(Registry.Families.Num());
+			}
+			SimulatedModifierLevels[FamilyIndex] = Level;
+
+			// Only one of these is replicated, don't dirty the other
+			if (bReplicatePackedSimulatedState)
+			{
+				if (SimulatedState.SetLevel(FamilyIndex, Level))
+				{
+					MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedState, this);
+				}
+			}
+			else
+			{
+				SetReplicatedFamilyLevel(FamilyIndex, Level);
+			}
 		}
-		else if (ModifierType == FModifierTags::Modifier_Snare)
+	}
+}
+
+void AModifierCharacter::SetReplicatedFamilyLevel(int32 FamilyIndex, uint8 Level)
+{
+	switch (static_cast<EModifierType>(FamilyIndex))
+	{
+	case EModifierType::Boost:
+		SimulatedBoost = Level;
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedBoost, this);
+		break;
+	case EModifierType::Snare:
+		SimulatedSnare = Level;
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedSnare, this);
+		break;
+	case EModifierType::SlowFall:
+		SimulatedSlowFall = Level;
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedSlowFall, this);
+		break;
+	default:
 		{
-			SimulatedSnare = ModifierMovement->GetSnareLevelIndex(ModifierLevel);
-			MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedSnare, this);
+			const int32 CustomIndex = FamilyIndex - static_cast<int32>(EModifierType::Num);
+			if (!SimulatedCustomModifierLevels.IsValidIndex(CustomIndex))
+			{
+				SimulatedCustomModifierLevels.SetNum(CustomIndex + 1);
+			}
+			SimulatedCustomModifierLevels[CustomIndex] = Level;
+			MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedCustomModifierLevels, this);
 		}
-		else if (ModifierType == FModifierTags::Modifier_SlowFall)
+		break;
+	}
+}
+
+void AModifierCharacter::OnRep_SimulatedBoost(uint8 PrevLevel)
+{
+	OnRep_SimulatedFamilyLevel(static_cast<int32>(EModifierType::Boost), SimulatedBoost);
+}
+
+void AModifierCharacter::OnRep_SimulatedSnare(uint8 PrevLevel)
+{
+	OnRep_SimulatedFamilyLevel(static_cast<int32>(EModifierType::Snare), SimulatedSnare);
+}
+
+void AModifierCharacter::OnRep_SimulatedSlowFall(uint8 PrevLevel)
+{
+	OnRep_SimulatedFamilyLevel(static_cast<int32>(EModifierType::SlowFall), SimulatedSlowFall);
+}
+
+void AModifierCharacter::OnRep_SimulatedCustomModifierLevels()
+{
+	// Mirror every custom family at once so they are notified with a single OnRep_SimulatedModifierLevels
+	const int32 FirstCustom = static_cast<int32>(EModifierType::Num);
+	const int32 NumFamilies = FMath::Min(SimulatedModifierLevels.Num(), FirstCustom + SimulatedCustomModifierLevels.Num());
+
+	TArray<uint8> PrevLevels = SimulatedModifierLevels;
+	bool bChanged = false;
+	for (int32 i = FirstCustom; i < NumFamilies; ++i)
+	{
+		bChanged |= SimulatedModifierLevels[i] != SimulatedCustomModifierLevels[i - FirstCustom];
+		SimulatedModifierLevels[i] = SimulatedCustomModifierLevels[i - FirstCustom];
+	}
+
+	if (bChanged)
+	{
+		OnRep_SimulatedModifierLevels(PrevLevels);
+	}
+}
+
+void AModifierCharacter::OnRep_SimulatedFamilyLevel(int32 FamilyIndex, uint8 Level)
+{
+	if (SimulatedModifierLevels.IsValidIndex(FamilyIndex) && SimulatedModifierLevels[FamilyIndex] != Level)
+	{
+		TArray<uint8> PrevLevels = SimulatedModifierLevels;
+		SimulatedModifierLevels[FamilyIndex] = Level;
+		OnRep_SimulatedModifierLevels(PrevLevels);
+	}
+}
+
+void AModifierCharacter::OnRep_SimulatedState(const FPredictedSimulatedState& PrevState)
+{
+	// Mirror the levels so OnRep_SimulatedModifierLevels has the same inputs as if they were replicated directly
+	if (SimulatedState.Levels != PrevState.Levels)
+	{
+		TArray<uint8> PrevLevels = SimulatedModifierLevels;
+		SimulatedModifierLevels.SetNum(SimulatedState.Levels.Num());
+		for (int32 i = 0; i < SimulatedState.Levels.Num(); ++i)
 		{
-			SimulatedSlowFall = ModifierMovement->GetSlowFallLevelIndex(ModifierLevel);
-			MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SimulatedSlowFall, this);
+			SimulatedModifierLevels[i] = SimulatedState.Levels[i];
 		}
+		OnRep_SimulatedModifierLevels(PrevLevels);
 	}
 }
 
-void AModifierCharacter::OnModifierAdded(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel,
-	const FGameplayTag& PrevModifierLevel)
+void AModifierCharacter::OnRep_SimulatedModifierLevels(const TArray<uint8>& PrevLevels)
 {
+	// Distant or unseen proxies only apply the latest levels once they are significant again
+	if (PredictedMovementSignificance::ShouldDeferSimulatedProxy(this))
+	{
+		if (!bDeferredModifierRep)
+		{
+			bDeferredModifierRep = true;
+			DeferredPrevModifierLevels = PrevLevels;
+		}
+		return;
+	}
+
+	if (bDeferredModifierRep)
+	{
+		bDeferredModifierRep = false;
+		ApplySimulatedModifierLevels(DeferredPrevModifierLevels);
+		return;
+	}
+
+	ApplySimulatedModifierLevels(PrevLevels);
+}
+
+void AModifierCharacter::FlushDeferredModifierRep()
+{
+	if (bDeferredModifierRep && !PredictedMovementSignificance::ShouldDeferSimulatedProxy(this))
+	{
+		bDeferredModifierRep = false;
+		ApplySimulatedModifierLevels(DeferredPrevModifierLevels);
+	}
+}
+
+void AModifierCharacter::ApplySimulatedModifierLevels(const TArray<uint8>& PrevLevels)
+{
+	if (!ModifierMovement)
+	{
+		return;
+	}
+
+	const FModifierRegistry& Registry = ModifierMovement->GetModifierRegistry();
+	const int32 NumFamilies = FMath::Min(Registry.Families.Num(), SimulatedModifierLevels.Num());
+
+	bool bChanged = false;
+	for (int32 i = 0; i < NumFamilies; ++i)
+	{
+		const uint8 PrevLevel = PrevLevels.IsValidIndex(i) ? PrevLevels[i] : NO_MODIFIER;
+		if (SimulatedModifierLevels[i] != PrevLevel)
+		{
+			const FModifierFamily& Family = Registry.Families[i];
+			const FGameplayTag PrevLevelTag = Family.GetLevelTag(*Family.Level);
+			*Family.Level = SimulatedModifierLevels[i];
+			NotifyModifierChanged(i, Family.Type, Family.GetLevelTag(*Family.Level),
+				PrevLevelTag, *Family.Level, PrevLevel, NO_MODIFIER);
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+	{
+		ModifierMovement->bNetworkUpdateReceived = true;
+	}
+}
+
+void AModifierCharacter::OnModifierAdded(int32 FamilyIndex, const FGameplayTag& ModifierType,
+	const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel)
+{
+	PRAGMA_DISABLE_DEPRECATION_WARNINGS
+	OnModifierAdded(ModifierType, ModifierLevel, PrevModifierLevel);
+	PRAGMA_ENABLE_DEPRECATION_WARNINGS
+
 	K2_OnModifierAdded(ModifierType, ModifierLevel, PrevModifierLevel);
 }
 
-void AModifierCharacter::OnModifierRemoved(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel,
-	const FGameplayTag& PrevModifierLevel)
+void AModifierCharacter::OnModifierRemoved(int32 FamilyIndex, const FGameplayTag& ModifierType,
+	const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel)
 {
+	PRAGMA_DISABLE_DEPRECATION_WARNINGS
+	OnModifierRemoved(ModifierType, ModifierLevel, PrevModifierLevel);
+	PRAGMA_ENABLE_DEPRECATION_WARNINGS
+
 	K2_OnModifierRemoved(ModifierType, ModifierLevel, PrevModifierLevel);
 }
 
@@ -77,96 +294,102 @@ void AModifierCharacter::GrantClientAuthority(FGameplayTag ClientAuthSource, flo
 	}
 }
 
-/* Boost Implementation */
-
-void AModifierCharacter::OnRep_SimulatedBoost(uint8 PrevLevel)
+FMovementModifier* AModifierCharacter::GetModifierForRequest(const FGameplayTag& ModifierType,
+	EModifierNetType NetType) const
 {
-	if (ModifierMovement && SimulatedBoost != PrevLevel)
+	if (!ModifierMovement || GetLocalRole() == ROLE_SimulatedProxy)
 	{
-		const FGameplayTag PrevBoostLevel = ModifierMovement->GetBoostLevel();
-		ModifierMovement->BoostLevel = SimulatedBoost;
-		NotifyModifierChanged(FModifierTags::Modifier_Boost, ModifierMovement->GetBoostLevel(),
-			PrevBoostLevel, ModifierMovement->BoostLevel, PrevLevel, NO_MODIFIER);
+		return nullptr;
+	}
 
-		ModifierMovement->bNetworkUpdateReceived = true;
+	// Only the server can change server initiated modifiers
+	if (NetType == EModifierNetType::ServerInitiated && !HasAuthority())
+	{
+		return nullptr;
 	}
+
+	return ModifierMovement->FindModifier(ModifierType, NetType);
 }
 
-bool AModifierCharacter::Boost(FGameplayTag Level, EModifierNetType NetType)
+bool AModifierCharacter::AddModifier(FGameplayTag ModifierType, FGameplayTag Level, EModifierNetType NetType)
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy && Level.IsValid())
+	FMovementModifier* Modifier = Level.IsValid() ? GetModifierForRequest(ModifierType, NetType) : nullptr;
+	if (Modifier)
 	{
-		const uint8 LevelIndex = ModifierMovement->GetBoostLevelIndex(Level);
+		const uint8 LevelIndex = ModifierMovement->GetModifierLevelIndex(ModifierType, Level);
 		if (LevelIndex == NO_MODIFIER)
 		{
 			return false;
 		}
 		
-		switch (NetType)
-		{
-		case EModifierNetType::LocalPredicted:
-			return ModifierMovement->BoostLocal.AddModifier(LevelIndex);
-		case EModifierNetType::WithCorrection:
-			return ModifierMovement->BoostCorrection.AddModifier(LevelIndex);
-		case EModifierNetType::ServerInitiated:
-			if (HasAuthority())
-			{
-				return ModifierMovement->BoostServer.AddModifier(LevelIndex);
-			}
-		default: return false;
-		}
+		return Modifier->AddModifier(LevelIndex);
 	}
 	return false;
 }
 
-bool AModifierCharacter::UnBoost(FGameplayTag Level, EModifierNetType NetType, bool bRemoveAll)
+bool AModifierCharacter::RemoveModifier(FGameplayTag ModifierType, FGameplayTag Level, EModifierNetType NetType,
+	bool bRemoveAll)
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy && Level.IsValid())
+	FMovementModifier* Modifier = Level.IsValid() ? GetModifierForRequest(ModifierType, NetType) : nullptr;
+	if (Modifier)
 	{
-		const uint8 LevelIndex = ModifierMovement->GetBoostLevelIndex(Level);
+		const uint8 LevelIndex = ModifierMovement->GetModifierLevelIndex(ModifierType, Level);
 		if (LevelIndex == NO_MODIFIER)
 		{
 			return false;
 		}
-		
-		switch (NetType)
-		{
-		case EModifierNetType::LocalPredicted:
-			return ModifierMovement->BoostLocal.RemoveModifier(LevelIndex, bRemoveAll);
-		case EModifierNetType::WithCorrection:
-			return ModifierMovement->BoostCorrection.RemoveModifier(LevelIndex, bRemoveAll);
-		case EModifierNetType::ServerInitiated:
-			if (HasAuthority())
-			{
-				return ModifierMovement->BoostServer.RemoveModifier(LevelIndex, bRemoveAll);
-			}
-		default: return false;
-		}
+
+		return Modifier->RemoveModifier(LevelIndex, bRemoveAll);
 	}
 	return false;
 }
 
-bool AModifierCharacter::ResetBoost(EModifierNetType NetType)
+bool AModifierCharacter::AddTimedModifier(FGameplayTag ModifierType, FGameplayTag Level, float Duration)
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy)
+	// Only server initiated modifiers are timed, the client learns the expiry with the correction that adds it
+	FMovementModifier* Modifier = Level.IsValid() && Duration > 0.f ?
+		GetModifierForRequest(ModifierType, EModifierNetType::ServerInitiated) : nullptr;
+	if (Modifier)
 	{
-		switch (NetType)
+		const uint8 LevelIndex = ModifierMovement->GetModifierLevelIndex(ModifierType, Level);
+		if (LevelIndex == NO_MODIFIER)
 		{
-		case EModifierNetType::LocalPredicted:
-			return ModifierMovement->BoostLocal.ResetModifiers();
-		case EModifierNetType::WithCorrection:
-			return ModifierMovement->BoostCorrection.ResetModifiers();
-		case EModifierNetType::ServerInitiated:
-			if (HasAuthority())
-			{
-				return ModifierMovement->BoostServer.ResetModifiers();
-			}
-		default: return false;
+			return false;
 		}
+
+		return Modifier->AddTimedModifier(LevelIndex, ModifierMovement->GetModifierExpiryTimestamp(Duration));
 	}
 	return false;
 }
 
+bool AModifierCharacter::ResetModifiers(FGameplayTag ModifierType, EModifierNetType NetType)
+{
+	FMovementModifier* Modifier = GetModifierForRequest(ModifierType, NetType);
+	return Modifier && Modifier->ResetModifiers();
+}
+
+/* Boost Implementation */
+
+bool AModifierCharacter::Boost(FGameplayTag Level, EModifierNetType NetType)
+{
+	return AddModifier(FModifierTags::Modifier_Boost, Level, NetType);
+}
+
+bool AModifierCharacter::BoostFor(FGameplayTag Level, float Duration)
+{
+	return AddTimedModifier(FModifierTags::Modifier_Boost, Level, Duration);
+}
+
+bool AModifierCharacter::UnBoost(FGameplayTag Level, EModifierNetType NetType, bool bRemoveAll)
+{
+	return RemoveModifier(FModifierTags::Modifier_Boost, Level, NetType, bRemoveAll);
+}
+
+bool AModifierCharacter::ResetBoost(EModifierNetType NetType)
+{
+	return ResetModifiers(FModifierTags::Modifier_Boost, NetType);
+}
+
 FGameplayTag AModifierCharacter::GetBoostLevel() const
 {
 	return ModifierMovement ? ModifierMovement->GetBoostLevel() : FGameplayTag::EmptyTag;
@@ -181,56 +404,24 @@ bool AModifierCharacter::IsBoostActive() const
 
 /* Snare Implementation */
 
-void AModifierCharacter::OnRep_SimulatedSnare(uint8 PrevLevel)
+bool AModifierCharacter::Snare(FGameplayTag Level)
 {
-	if (ModifierMovement && SimulatedSnare != PrevLevel)
-	{
-		const FGameplayTag PrevSnareLevel = ModifierMovement->GetSnareLevel();
-		ModifierMovement->SnareLevel = SimulatedSnare;
-		NotifyModifierChanged(FModifierTags::Modifier_Snare, ModifierMovement->GetSnareLevel(),
-			PrevSnareLevel, ModifierMovement->SnareLevel, PrevLevel, NO_MODIFIER);
-
-		ModifierMovement->bNetworkUpdateReceived = true;
-	}
+	return AddModifier(FModifierTags::Modifier_Snare, Level, EModifierNetType::ServerInitiated);
 }
 
-bool AModifierCharacter::Snare(FGameplayTag Level)
+bool AModifierCharacter::SnareFor(FGameplayTag Level, float Duration)
 {
-	if (ModifierMovement && HasAuthority() && Level.IsValid())
-	{
-		const uint8 LevelIndex = ModifierMovement->GetSnareLevelIndex(Level);
-		if (LevelIndex == NO_MODIFIER)
-		{
-			return false;
-		}
-		
-		return ModifierMovement->SnareServer.AddModifier(LevelIndex);
-	}
-	return false;
+	return AddTimedModifier(FModifierTags::Modifier_Snare, Level, Duration);
 }
 
 bool AModifierCharacter::UnSnare(FGameplayTag Level, bool bRemoveAll)
 {
-	if (ModifierMovement && HasAuthority() && Level.IsValid())
-	{
-		const uint8 LevelIndex = ModifierMovement->GetSnareLevelIndex(Level);
-		if (LevelIndex == NO_MODIFIER)
-		{
-			return false;
-		}
-
-		return ModifierMovement->SnareServer.RemoveModifier(LevelIndex, bRemoveAll);
-	}
-	return false;
+	return RemoveModifier(FModifierTags::Modifier_Snare, Level, EModifierNetType::ServerInitiated, bRemoveAll);
 }
 
 bool AModifierCharacter::ResetSnare()
 {
-	if (ModifierMovement && HasAuthority())
-	{
-		return ModifierMovement->SnareServer.ResetModifiers();
-	}
-	return false;
+	return ResetModifiers(FModifierTags::Modifier_Snare, EModifierNetType::ServerInitiated);
 }
 
 FGameplayTag AModifierCharacter::GetSnareLevel() const
@@ -247,56 +438,19 @@ bool AModifierCharacter::IsSnareActive() const
 
 /* SlowFall Implementation */
 
-void AModifierCharacter::OnRep_SimulatedSlowFall(uint8 PrevLevel)
-{
-	if (ModifierMovement && SimulatedSlowFall != PrevLevel)
-	{
-		const FGameplayTag PrevSlowFallLevel = ModifierMovement->GetSlowFallLevel();
-		ModifierMovement->SlowFallLevel = SimulatedSlowFall;
-		NotifyModifierChanged(FModifierTags::Modifier_SlowFall, ModifierMovement->GetSlowFallLevel(),
-			PrevSlowFallLevel, ModifierMovement->SlowFallLevel, PrevLevel, NO_MODIFIER);
-
-		ModifierMovement->bNetworkUpdateReceived = true;
-	}
-}
-
 bool AModifierCharacter::SlowFall(FGameplayTag Level)
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy && Level.IsValid())
-	{
-		const uint8 LevelIndex = ModifierMovement->GetSlowFallLevelIndex(Level);
-		if (LevelIndex == NO_MODIFIER)
-		{
-			return false;
-		}
-		
-		return ModifierMovement->SlowFallLocal.AddModifier(LevelIndex);
-	}
-	return false;
+	return AddModifier(FModifierTags::Modifier_SlowFall, Level, EModifierNetType::LocalPredicted);
 }
 
 bool AModifierCharacter::UnSlowFall(FGameplayTag Level, bool bRemoveAll)
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy && Level.IsValid())
-	{
-		const uint8 LevelIndex = ModifierMovement->GetSlowFallLevelIndex(Level);
-		if (LevelIndex == NO_MODIFIER)
-		{
-			return false;
-		}
-		
-		return ModifierMovement->SlowFallLocal.RemoveModifier(LevelIndex, bRemoveAll);
-	}
-	return false;
+	return RemoveModifier(FModifierTags::Modifier_SlowFall, Level, EModifierNetType::LocalPredicted, bRemoveAll);
 }
 
 bool AModifierCharacter::ResetSlowFall()
 {
-	if (ModifierMovement && GetLocalRole() != ROLE_SimulatedProxy)
-	{
-		return ModifierMovement->SlowFallLocal.ResetModifiers();
-	}
-	return false;
+	return ResetModifiers(FModifierTags::Modifier_SlowFall, EModifierNetType::LocalPredicted);
 }
 
 FGameplayTag AModifierCharacter::GetSlowFallLevel() const
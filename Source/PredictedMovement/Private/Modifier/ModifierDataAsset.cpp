@@ -0,0 +1,62 @@
+// Copyright (c) Jared Taylor
+
+
+#include "Modifier/ModifierDataAsset.h"
+
+#include "Modifier/ModifierTags.h"
+#include "System/PredictedMovementTrace.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(ModifierDataAsset)
+
+UModifierDataAsset::UModifierDataAsset(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Init Modifier Levels
+	Boost.Add(FModifierTags::Modifier_Boost, { 1.50f });  // 50% Speed Boost
+	Snare.Add(FModifierTags::Modifier_Snare, { 0.50f });  // 50% Speed Snare
+	SlowFall.Add(FModifierTags::Modifier_SlowFall, { 0.1f });  // 90% Gravity Reduction
+
+	// Auth params for Snare
+	static constexpr int32 DefaultPriority = 5;
+	ClientAuthParams.FindOrAdd(FModifierTags::ClientAuth_Snare, { DefaultPriority });
+}
+
+void UModifierDataAsset::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// The CDO serves as the default definition for components without an asset
+	BuildModifierLevelTables();
+}
+
+void UModifierDataAsset::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildModifierLevelTables();
+}
+
+#if WITH_EDITOR
+void UModifierDataAsset::PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FProperty* PropertyThatChanged = PropertyChangedEvent.MemberProperty;
+	if (PropertyThatChanged && (
+		PropertyThatChanged->GetFName() == GET_MEMBER_NAME_CHECKED(ThisClass, Boost) ||
+		PropertyThatChanged->GetFName() == GET_MEMBER_NAME_CHECKED(ThisClass, Snare) ||
+		PropertyThatChanged->GetFName() == GET_MEMBER_NAME_CHECKED(ThisClass, SlowFall)))
+	{
+		BuildModifierLevelTables();
+	}
+}
+#endif
+
+void UModifierDataAsset::BuildModifierLevelTables()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierDataAsset::BuildModifierLevelTables);
+
+	BoostLevels.Build(Boost);
+	SnareLevels.Build(Snare);
+	SlowFallLevels.Build(SlowFall);
+}
@@ -2,9 +2,17 @@
 
 
 #include "Modifier/ModifierImpl.h"
-#include "Algo/Accumulate.h"
-#include "Algo/MaxElement.h"
-#include "Algo/MinElement.h"
+
+#include "Hash/CityHash.h"
+#include "System/PredictedMovementTrace.h"
+
+// SSE2 is always available on x86-64, other platforms use the scalar path
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#define MODIFIER_LEVEL_SIMD 1
+#else
+#define MODIFIER_LEVEL_SIMD 0
+#endif
 
 bool FModifierMoveData_LocalPredicted::Serialize(FArchive& Ar, const FString& ErrorName,
 	uint8 MaxSerializedModifiers)
@@ -24,30 +32,62 @@ bool FModifierMoveData_ServerInitiated::Serialize(FArchive& Ar, const FString& E
 	return FModifierStatics::NetSerialize(Modifiers, Ar, ErrorName, MaxSerializedModifiers);
 }
 
+bool FMovementModifier::ExpireModifiers(float Timestamp)
+{
+	bool bExpired = false;
+	for (int32 i = Expiries.Num() - 1; i >= 0; --i)
+	{
+		if (Timestamp >= Expiries[i].Timestamp)
+		{
+			WantsModifiers.RemoveSingle(Expiries[i].Level);
+			Expiries.RemoveAt(i, 1, EAllowShrinking::No);
+			bExpired = true;
+		}
+	}
+	return bExpired;
+}
+
+void FMovementModifier::TrimExpiries()
+{
+	for (int32 i = Expiries.Num() - 1; i >= 0; --i)
+	{
+		const TModSize Level = Expiries[i].Level;
+		int32 NumExpiries = 0;
+		for (const FModifierExpiry& Expiry : Expiries)
+		{
+			NumExpiries += Expiry.Level == Level ? 1 : 0;
+		}
+
+		if (NumExpiries > GetNumWantedModifiersByLevel(Level))
+		{
+			Expiries.RemoveAt(i, 1, EAllowShrinking::No);
+		}
+	}
+}
+
 TModSize FMovementModifier::GetNumWantedModifiersByLevel(TModSize Level) const
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FMovementModifier::GetNumWantedModifiersByLevel);
-	
-	return WantsModifiers.FilterByPredicate([Level](uint8 ModifierLevel)
+	// Count in place, FilterByPredicate would allocate a copy of the stack
+	TModSize Num = 0;
+	for (const TModSize& ModifierLevel : WantsModifiers)
 	{
-		return ModifierLevel == Level;
-	}).Num();
+		Num += ModifierLevel == Level ? 1 : 0;
+	}
+	return Num;
 }
 
 TModSize FMovementModifier::GetNumModifiersByLevel(TModSize Level) const
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FMovementModifier::GetNumModifiersByLevel);
-	
-	return Modifiers.FilterByPredicate([Level](uint8 ModifierLevel)
+	TModSize Num = 0;
+	for (const TModSize& ModifierLevel : Modifiers)
 	{
-		return ModifierLevel == Level;
-	}).Num();
+		Num += ModifierLevel == Level ? 1 : 0;
+	}
+	return Num;
 }
 
 void FMovementModifier::LimitNumModifiers(TModifierStack& Modifiers, int32& RemainingModifiers)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FMovementModifier::LimitNumModifiers);
-	
 	if (Modifiers.Num() > RemainingModifiers)
 	{
 		// Limit the number of modifiers to the maximum allowed
@@ -69,10 +109,12 @@ void FMovementModifier::LimitNumModifiers(TModifierStack& Modifiers, int32& Rema
 
 bool FMovementModifier::UpdateMovementState(bool bAllowedInCurrentState, bool bClampMax, int32& Remaining)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FMovementModifier::UpdateMovementState);
-	
-	// Only update the modifiers if the current state allows it
-	TModifierStack CurrentModifiers = bAllowedInCurrentState ? WantsModifiers : TModifierStack();
+	// Only update the modifiers if the current state allows it -- TModifierStack is inline, this doesn't allocate
+	TModifierStack CurrentModifiers;
+	if (bAllowedInCurrentState)
+	{
+		CurrentModifiers = WantsModifiers;
+	}
 
 	// Clamp the number of modifiers to the maximum allowed -- this removes old modifiers first
 	// Note: There may be potential for de-sync if client removes server modifiers out of order (cross that bridge when we get there)
@@ -92,13 +134,16 @@ bool FMovementModifier::UpdateMovementState(bool bAllowedInCurrentState, bool bC
 
 bool FModifierStatics::NetSerialize(TModifierStack& Modifiers, FArchive& Ar, const FString& ErrorName, uint8 MaxSerializedModifiers)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FModifierStatics::NetSerialize);
+	PREDICTED_MOVEMENT_SCOPE(FModifierStatics::NetSerialize);
 	
 	// Don't serialize modifier stack if the max is 0
 	if (MaxSerializedModifiers <= 1)
 	{
 		return !Ar.IsError();
 	}
+
+	// The stack has fixed inline storage, never read more than it can hold
+	MaxSerializedModifiers = FMath::Min<uint8>(MaxSerializedModifiers, MAX_MODIFIER_STACK_SIZE);
 	
 	// Serialize the number of elements
 	TModSize NumModifiers = Modifiers.Num();
@@ -128,141 +173,313 @@ bool FModifierStatics::NetSerialize(TModifierStack& Modifiers, FArchive& Ar, con
 	return !Ar.IsError();
 }
 
-TModSize FModifierStatics::UpdateModifierLevel(EModifierLevelMethod Method, const TModifierStack& Modifiers,
-	TModSize MaxLevel, TModSize InvalidLevel)
+bool FModifierStatics::NetSerializePacked(TModifierStack& Modifiers, FArchive& Ar, const TCHAR* ErrorName,
+	int32 NumLevels, uint8 MaxSerializedModifiers)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FModifierStatics::UpdateModifierLevel);
-	
-	if (Modifiers.IsEmpty())
+	PREDICTED_MOVEMENT_SCOPE(FModifierStatics::NetSerializePacked);
+
+	// The stack has fixed inline storage, never read more than it can hold
+	MaxSerializedModifiers = FMath::Min<uint8>(MaxSerializedModifiers, MAX_MODIFIER_STACK_SIZE);
+
+	// Nothing can be represented, the caller should not have flagged this stack as present
+	if (MaxSerializedModifiers == 0 || NumLevels <= 0)
 	{
-		return InvalidLevel;
+		if (Ar.IsLoading())
+		{
+			Modifiers.Reset();
+		}
+		return !Ar.IsError();
 	}
 
-	TModSize NewLevel;
+	if (Ar.IsSaving() && !ensureMsgf(Modifiers.Num() > 0,
+		TEXT("Serializing empty modifier %s array as present -- Check packet serialization logic"), ErrorName))
+	{
+		Ar.SetError();
+		return false;
+	}
 
-	switch (Method)
+	// Presence is signalled by the caller, so the stack is never empty and we only need to send Num - 1
+	uint32 NumModifiers = 0;
+	if (Ar.IsSaving())
 	{
-	case EModifierLevelMethod::Max:
-		NewLevel = *Algo::MaxElement(Modifiers);
-		break;
+		NumModifiers = FMath::Min<uint32>(Modifiers.Num(), MaxSerializedModifiers) - 1;
+	}
+	SerializeBounded(Ar, NumModifiers, MaxSerializedModifiers);
 
-	case EModifierLevelMethod::Min:
-		NewLevel = *Algo::MinElement(Modifiers);
-		break;
+	// Resize the array if needed
+	if (Ar.IsLoading())
+	{
+		NumModifiers = FMath::Min<uint32>(NumModifiers, MaxSerializedModifiers - 1);
+		Modifiers.SetNum(NumModifiers + 1);
+	}
 
-	case EModifierLevelMethod::Stack:
+	// Serialize the levels
+	const uint32 MaxLevels = static_cast<uint32>(NumLevels);
+	for (uint32 i = 0; i <= NumModifiers; ++i)
+	{
+		uint32 Level = Modifiers[i];
+		if (Ar.IsSaving() && !ensureMsgf(Level < MaxLevels,
+			TEXT("Serializing modifier %s level %d when only %d levels exist -- Check modifier level tables"), ErrorName, Level, NumLevels))
 		{
-			uint64 Total = 0;
-			for (const TModSize& Level : Modifiers)
-			{
-				// We are only counting the number of modifiers, so we add 1 because levels are 0-based
-				Total += Level + 1;
-			}
-
-			// Subtract 1 to convert back to 0-based level
-			NewLevel = Total > 0 ? Total - 1 : 0;
+			Level = MaxLevels - 1;
 		}
-		break;
 
-	case EModifierLevelMethod::Average:
+		SerializeBounded(Ar, Level, MaxLevels);
+
+		if (Ar.IsLoading())
 		{
-			uint64 Total = 0;
-			for (const TModSize& Level : Modifiers)
-			{
-				// We don't add 1 here because we are averaging the levels, not counting them
-				Total += Level;
-			}
-			NewLevel = static_cast<TModSize>(Total / Modifiers.Num());
+			Modifiers[i] = static_cast<TModSize>(FMath::Min<uint32>(Level, MaxLevels - 1));
 		}
-		break;
+	}
 
-	default:
-		return InvalidLevel;
+	return !Ar.IsError();
+}
+
+void FModifierStatics::SerializeBounded(FArchive& Ar, uint32& Value, uint32 ValueMax)
+{
+	if (ValueMax > 1)
+	{
+		Value = FMath::Min<uint32>(Value, ValueMax - 1);
+		Ar.SerializeInt(Value, ValueMax);
 	}
+	else
+	{
+		Value = 0;
+	}
+}
 
-	// Clamp to max allowed
-	return FMath::Clamp(NewLevel, 0, MaxLevel);
+FModifierLevelReduction FModifierStatics::ReduceModifierLevels(const TModifierStack& Modifiers)
+{
+	FModifierLevelReduction Reduction;
+	Reduction.Num = Modifiers.Num();
+	if (Reduction.Num == 0)
+	{
+		return Reduction;
+	}
+
+#if MODIFIER_LEVEL_SIMD
+	if constexpr (sizeof(TModSize) == 1 && MAX_MODIFIER_STACK_SIZE == 32)
+	{
+		// TFixedAllocator always has storage for MAX_MODIFIER_STACK_SIZE, so reading all of it is safe
+		const __m128i* Data = reinterpret_cast<const __m128i*>(Modifiers.GetData());
+		const __m128i Lo = _mm_loadu_si128(Data);
+		const __m128i Hi = _mm_loadu_si128(Data + 1);
+
+		// Lanes beyond Num are garbage, mask them to 0 for max and sum, and to 255 for min
+		const __m128i Count = _mm_set1_epi8(static_cast<char>(Reduction.Num));
+		const __m128i LoIndex = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		const __m128i HiIndex = _mm_setr_epi8(16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+		const __m128i LoMask = _mm_cmpgt_epi8(Count, LoIndex);
+		const __m128i HiMask = _mm_cmpgt_epi8(Count, HiIndex);
+
+		const __m128i LoValid = _mm_and_si128(Lo, LoMask);
+		const __m128i HiValid = _mm_and_si128(Hi, HiMask);
+
+		__m128i Max = _mm_max_epu8(LoValid, HiValid);
+		__m128i Min = _mm_min_epu8(_mm_or_si128(Lo, _mm_xor_si128(LoMask, _mm_set1_epi8(-1))),
+			_mm_or_si128(Hi, _mm_xor_si128(HiMask, _mm_set1_epi8(-1))));
+
+		// Horizontal reduction across the 16 lanes
+		Max = _mm_max_epu8(Max, _mm_srli_si128(Max, 8));
+		Max = _mm_max_epu8(Max, _mm_srli_si128(Max, 4));
+		Max = _mm_max_epu8(Max, _mm_srli_si128(Max, 2));
+		Max = _mm_max_epu8(Max, _mm_srli_si128(Max, 1));
+		Min = _mm_min_epu8(Min, _mm_srli_si128(Min, 8));
+		Min = _mm_min_epu8(Min, _mm_srli_si128(Min, 4));
+		Min = _mm_min_epu8(Min, _mm_srli_si128(Min, 2));
+		Min = _mm_min_epu8(Min, _mm_srli_si128(Min, 1));
+
+		// Sum of absolute differences against zero sums each half into a 16-bit lane
+		const __m128i Sum = _mm_add_epi64(_mm_sad_epu8(LoValid, _mm_setzero_si128()), _mm_sad_epu8(HiValid, _mm_setzero_si128()));
+
+		Reduction.Max = static_cast<TModSize>(_mm_cvtsi128_si32(Max) & 0xFF);
+		Reduction.Min = static_cast<TModSize>(_mm_cvtsi128_si32(Min) & 0xFF);
+		Reduction.Sum = static_cast<uint32>(_mm_cvtsi128_si32(Sum) + _mm_extract_epi16(Sum, 4));
+		return Reduction;
+	}
+#endif
+
+	Reduction.Max = Modifiers[0];
+	Reduction.Min = Modifiers[0];
+	for (const TModSize Level : Modifiers)
+	{
+		Reduction.Max = FMath::Max(Reduction.Max, Level);
+		Reduction.Min = FMath::Min(Reduction.Min, Level);
+		Reduction.Sum += Level;
+	}
+	return Reduction;
 }
 
-TModSize FModifierStatics::CombineModifierLevels(EModifierLevelMethod Method, const TModifierStack& ModifierLevels,
+TModSize FModifierStatics::ResolveModifierLevel(EModifierLevelMethod Method, const FModifierLevelReduction& Reduction,
 	TModSize MaxLevel, TModSize InvalidLevel)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FModifierStatics::CombineModifierLevels);
-	
-	if (ModifierLevels.IsEmpty())
+	const int32 MethodIndex = static_cast<int32>(Method);
+	if (Reduction.Num == 0 || MethodIndex > static_cast<int32>(EModifierLevelMethod::Average))
 	{
 		return InvalidLevel;
 	}
 
-	TModSize NewLevel;
+	// Indexed by EModifierLevelMethod
+	const int32 Levels[] =
+	{
+		Reduction.Max,
+		Reduction.Min,
+		static_cast<int32>(Reduction.Sum) + Reduction.Num - 1,	// Stack: each level is 0-based, so count 1 for each
+		static_cast<int32>(Reduction.Sum / Reduction.Num),		// Average
+	};
+
+	// Clamp to max allowed
+	return static_cast<TModSize>(FMath::Clamp<int32>(Levels[MethodIndex], 0, MaxLevel));
+}
 
-	switch (Method)
+void FModifierStatics::NetSerializeExpiries(TModifierExpiries& Expiries, FArchive& Ar, int32 NumLevels)
+{
+	bool bHasExpiries = Expiries.Num() > 0 && NumLevels > 0;
+	Ar.SerializeBits(&bHasExpiries, 1);
+	if (!bHasExpiries)
 	{
-	case EModifierLevelMethod::Max:
-		NewLevel = *Algo::MaxElement(ModifierLevels);
-		break;
+		if (Ar.IsLoading())
+		{
+			Expiries.Reset();
+		}
+		return;
+	}
 
-	case EModifierLevelMethod::Min:
-		NewLevel = *Algo::MinElement(ModifierLevels);
-		break;
+	uint32 NumExpiries = Expiries.Num();
+	SerializeBounded(Ar, NumExpiries, MAX_TIMED_MODIFIERS + 1);
+	if (Ar.IsLoading())
+	{
+		Expiries.SetNum(FMath::Min<uint32>(NumExpiries, MAX_TIMED_MODIFIERS));
+	}
+
+	for (FModifierExpiry& Expiry : Expiries)
+	{
+		uint32 Level = Expiry.Level;
+		SerializeBounded(Ar, Level, NumLevels);
+		Expiry.Level = static_cast<TModSize>(Level);
+		Ar << Expiry.Timestamp;
+	}
+}
 
-	case EModifierLevelMethod::Stack:
+uint64 FModifierStatics::HashModifiers(TArrayView<FMovementModifier* const> Modifiers)
+{
+	// The count is part of the seed, so moving a level from one stack to the next changes the hash
+	uint64 Hash = 0;
+	for (const FMovementModifier* Modifier : Modifiers)
+	{
+		for (const TModifierStack* Stack : { &Modifier->WantsModifiers, &Modifier->Modifiers })
 		{
-			uint64 Total = 0;
-			for (const TModSize& Level : ModifierLevels)
-			{
-				// We are only counting the number of modifiers, so we add 1 because levels are 0-based
-				Total += Level + 1;
-			}
-
-			// Subtract 1 to convert back to 0-based level
-			NewLevel = Total > 0 ? Total - 1 : 0;
+			Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Stack->GetData()), Stack->Num() * sizeof(TModSize),
+				Hash ^ static_cast<uint64>(Stack->Num() + 1));
 		}
-		break;
+	}
+	return Hash;
+}
+
+TModSize FModifierStatics::UpdateModifierLevel(EModifierLevelMethod Method, const TModifierStack& Modifiers,
+	TModSize MaxLevel, TModSize InvalidLevel)
+{
+	return ResolveModifierLevel(Method, ReduceModifierLevels(Modifiers), MaxLevel, InvalidLevel);
+}
+
+void FModifierStatics::UpdateModifierLevels(EModifierLevelMethod Method, TArrayView<const TModifierStack* const> Stacks,
+	TModSize MaxLevel, TModSize InvalidLevel, TArrayView<TModSize> OutLevels)
+{
+	check(Stacks.Num() == OutLevels.Num());
+	for (int32 i = 0; i < Stacks.Num(); ++i)
+	{
+		OutLevels[i] = ResolveModifierLevel(Method, ReduceModifierLevels(*Stacks[i]), MaxLevel, InvalidLevel);
+	}
+}
+
+TModSize FModifierStatics::CombineModifierLevels(EModifierLevelMethod Method, const TModifierStack& ModifierLevels,
+	TModSize MaxLevel, TModSize InvalidLevel)
+{
+	return ResolveModifierLevel(Method, ReduceModifierLevels(ModifierLevels), MaxLevel, InvalidLevel);
+}
+
+bool FModifierProcessCache::IsUpToDate(TModSize CurrentLevel, EModifierLevelMethod InMethod, int32 InNumLevels,
+	bool bInLimitMaxModifiers, int32 InMaxModifiers, bool bInAllowedInCurrentState,
+	TArrayView<FMovementModifier* const> Modifiers) const
+{
+	if (!bValid || Level != CurrentLevel || Method != InMethod || NumLevels != InNumLevels ||
+		bLimitMaxModifiers != bInLimitMaxModifiers || MaxModifiers != InMaxModifiers ||
+		bAllowedInCurrentState != bInAllowedInCurrentState || WantsModifiers.Num() != Modifiers.Num())
+	{
+		return false;
+	}
 
-	case EModifierLevelMethod::Average:
+	for (int32 i = 0; i < Modifiers.Num(); ++i)
+	{
+		if (WantsModifiers[i] != Modifiers[i]->WantsModifiers)
 		{
-			uint64 Total = 0;
-			for (const TModSize& Level : ModifierLevels)
-			{
-				Total += Level;
-			}
-			NewLevel = static_cast<TModSize>(Total / ModifierLevels.Num());
+			return false;
 		}
-		break;
+	}
+	return true;
+}
 
-	default:
-		return InvalidLevel;
+void FModifierProcessCache::Update(TModSize CurrentLevel, EModifierLevelMethod InMethod, int32 InNumLevels,
+	bool bInLimitMaxModifiers, int32 InMaxModifiers, bool bInAllowedInCurrentState,
+	TArrayView<FMovementModifier* const> Modifiers)
+{
+	WantsModifiers.SetNum(Modifiers.Num(), EAllowShrinking::No);
+	for (int32 i = 0; i < Modifiers.Num(); ++i)
+	{
+		WantsModifiers[i] = Modifiers[i]->WantsModifiers;
 	}
 
-	// Clamp to max allowed
-	return FMath::Clamp(NewLevel, 0, MaxLevel);
+	Level = CurrentLevel;
+	Method = InMethod;
+	NumLevels = InNumLevels;
+	bLimitMaxModifiers = bInLimitMaxModifiers;
+	MaxModifiers = InMaxModifiers;
+	bAllowedInCurrentState = bInAllowedInCurrentState;
+	bValid = true;
 }
 
 bool FModifierStatics::ProcessModifiers(TModSize& CurrentLevel, EModifierLevelMethod Method,
 	const TArray<FGameplayTag>& LevelTags, bool bLimitMaxModifiers, int32 MaxModifiers, TModSize InvalidLevel,
-	const TArray<FMovementModifier*>& Modifiers, const TFunctionRef<bool()>& CanActivateCallback)
+	TArrayView<FMovementModifier* const> Modifiers, const TFunctionRef<bool()>& CanActivateCallback,
+	FModifierProcessCache* Cache)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FModifierStatics::ProcessModifiers);
+	PREDICTED_MOVEMENT_SCOPE(FModifierStatics::ProcessModifiers);
+
+	// The state doesn't change between modifiers of the same family
+	const bool bAllowedInCurrentState = CanActivateCallback();
+
+	// Nothing that feeds into the state has changed since we last processed this family
+	if (Cache && Cache->IsUpToDate(CurrentLevel, Method, LevelTags.Num(), bLimitMaxModifiers, MaxModifiers,
+		bAllowedInCurrentState, Modifiers))
+	{
+		return false;
+	}
 	
 	const TModSize PrevLevel = CurrentLevel;
 
 	// Determine the maximum level based on the available tags
 	const TModSize MaxLevel = LevelTags.Num() > 0 ? static_cast<TModSize>(LevelTags.Num() - 1) : 0;
 
-	// Track modifier data
+	// Track modifier data -- TModifierStack is inline, this doesn't allocate
 	bool bStateChanged = false;
-	TArray<TModSize> Levels;
+	TModifierStack Levels;
 	int32 Remaining = MaxModifiers;
 
 	// Iterate through all modifiers and update their state
+	TArray<const TModifierStack*, TInlineAllocator<3>> Stacks;
 	for (FMovementModifier* Modifier : Modifiers)
 	{
 		// Track if any state changed
-		bStateChanged |= Modifier->UpdateMovementState(CanActivateCallback(), bLimitMaxModifiers, Remaining);
+		bStateChanged |= Modifier->UpdateMovementState(bAllowedInCurrentState, bLimitMaxModifiers, Remaining);
+		Stacks.Add(&Modifier->Modifiers);
+	}
 
-		// Always read and process the current modifier data
-		const TModSize NewLevel = UpdateModifierLevel(Method, Modifier->Modifiers, MaxLevel, InvalidLevel);
+	// Always read and process the current modifier data
+	TArray<TModSize, TInlineAllocator<3>> StackLevels;
+	StackLevels.SetNumUninitialized(Stacks.Num());
+	UpdateModifierLevels(Method, Stacks, MaxLevel, InvalidLevel, StackLevels);
+	for (const TModSize NewLevel : StackLevels)
+	{
 		if (NewLevel != InvalidLevel)
 		{
 			Levels.Add(NewLevel);
@@ -272,5 +489,10 @@ bool FModifierStatics::ProcessModifiers(TModSize& CurrentLevel, EModifierLevelMe
 	// Combine all active modifier levels
 	CurrentLevel = Levels.Num() > 0 ? CombineModifierLevels(Method, Levels, MaxLevel, InvalidLevel) : InvalidLevel;
 
+	if (Cache)
+	{
+		Cache->Update(CurrentLevel, Method, LevelTags.Num(), bLimitMaxModifiers, MaxModifiers, bAllowedInCurrentState, Modifiers);
+	}
+
 	return bStateChanged || CurrentLevel != PrevLevel;
 }
@@ -4,8 +4,10 @@
 #include "Modifier/ModifierMovement.h"
 
 #include "Modifier/ModifierCharacter.h"
+#include "Modifier/ModifierMovementSubsystem.h"
 #include "Modifier/ModifierTags.h"
-#include "Components/SkeletalMeshComponent.h"
+#include "System/PredictedMovementStats.h"
+#include "System/PredictedMovementTrace.h"
 
 #if WITH_EDITOR
 #include "Misc/DataValidation.h"
@@ -34,14 +36,26 @@ UModifierMovement::UModifierMovement(const FObjectInitializer& ObjectInitializer
 	SetNetworkMoveDataContainer(ModifierMoveDataContainer);
 	SetMoveResponseDataContainer(ModifierMoveResponseDataContainer);
 
-	// Init Modifier Levels
-	Boost.Add(FModifierTags::Modifier_Boost, { 1.50f });  // 50% Speed Boost
-	Snare.Add(FModifierTags::Modifier_Snare, { 0.50f });  // 50% Speed Snare
-	SlowFall.Add(FModifierTags::Modifier_SlowFall, { 0.1f });  // 90% Gravity Reduction
+	// Modifier levels and client auth params are defined by UModifierDataAsset, until the tables are built these are empty
+	BoostLevels = &LocalBoostLevels;
+	SnareLevels = &LocalSnareLevels;
+	SlowFallLevels = &LocalSlowFallLevels;
 
-	// Auth params for Snare
-	static constexpr int32 DefaultPriority = 5;
-	ClientAuthParams.FindOrAdd(FModifierTags::ClientAuth_Snare, { DefaultPriority });
+	// Register the modifier families, each slot is predicted, sent and corrected based on its net type
+	verify(ModifierRegistry.AddFamily(FModifierTags::Modifier_Boost, BoostLevel, &ThisClass::CanBoostInCurrentState, {
+		{ &BoostLocal, EModifierNetType::LocalPredicted, TEXT("BoostLocal") },
+		{ &BoostCorrection, EModifierNetType::WithCorrection, TEXT("BoostCorrection") },
+		{ &BoostServer, EModifierNetType::ServerInitiated, TEXT("BoostServer") } }) == Family_Boost);
+
+	verify(ModifierRegistry.AddFamily(FModifierTags::Modifier_Snare, SnareLevel, &ThisClass::CanSnareInCurrentState, {
+		{ &SnareServer, EModifierNetType::ServerInitiated, TEXT("SnareServer") } }) == Family_Snare);
+
+	verify(ModifierRegistry.AddFamily(FModifierTags::Modifier_SlowFall, SlowFallLevel, &ThisClass::CanSlowFallInCurrentState, {
+		{ &SlowFallLocal, EModifierNetType::LocalPredicted, TEXT("SlowFallLocal") } }) == Family_SlowFall);
+
+	ModifierRegistry.Families[Family_Boost].SetLevels(*BoostLevels, BoostLevelMethod, bLimitMaxBoosts, MaxBoosts);
+	ModifierRegistry.Families[Family_Snare].SetLevels(*SnareLevels, SnareLevelMethod, bLimitMaxSnares, MaxSnares);
+	ModifierRegistry.Families[Family_SlowFall].SetLevels(*SlowFallLevels, SlowFallLevelMethod, bLimitMaxSlowFalls, MaxSlowFalls);
 }
 
 void FModifierMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement,
@@ -56,10 +70,16 @@ void FModifierMoveResponseDataContainer::ServerFillResponseData(const UCharacter
 	
 	const UModifierMovement* MoveComp = Cast<UModifierMovement>(&CharacterMovement);
 
-	// Fill the response data with the current modifier state
-	BoostCorrection.ServerFillResponseData(MoveComp->BoostCorrection.Modifiers);
-	BoostServer.ServerFillResponseData(MoveComp->BoostServer.Modifiers);
-	SnareServer.ServerFillResponseData(MoveComp->SnareServer.Modifiers);
+	// Fill the response data with the current modifier state, only the stacks the client got wrong are sent
+	const FModifierRegistry& Registry = MoveComp->GetModifierRegistry();
+	ModifierMask = MoveComp->ClientModifierErrorMask;
+	Modifiers.SetNum(Registry.NumCorrected(), EAllowShrinking::No);
+	Expiries.SetNum(Registry.NumCorrected(), EAllowShrinking::No);
+	for (int32 i = 0; i < Registry.NumCorrected(); ++i)
+	{
+		Modifiers[i] = Registry.Slots[Registry.CorrectedSlots[i]].Modifier->Modifiers;
+		Expiries[i] = Registry.Slots[Registry.CorrectedSlots[i]].Modifier->Expiries;
+	}
 
 	// Fill ClientAuthAlpha
 	ClientAuthAlpha = MoveComp->ClientAuthAlpha;
@@ -75,18 +95,64 @@ bool FModifierMoveResponseDataContainer::Serialize(UCharacterMovementComponent&
 	}
 
 	// Server ➜ Client
+	FPredictedMovementScopedNetBits ScopedNetBits(Ar, EPredictedNetFeature::ModifierMoveResponse);
 	if (IsCorrection())
 	{
-		// Serialize Modifiers
-		Ar << BoostCorrection.Modifiers;
-		Ar << BoostServer.Modifiers;
-		Ar << SnareServer.Modifiers;
+		// The level counts determine how many bits each level is packed to, they must match between client and server
+		const UModifierMovement& MoveComp = static_cast<const UModifierMovement&>(CharacterMovement);
+		const FModifierRegistry& Registry = MoveComp.GetModifierRegistry();
+		const int32 NumCorrected = Registry.NumCorrected();
+		static_assert(MAX_MODIFIER_SLOTS <= 32, "ModifierMask is a uint32");
+
+		// Serialize only the Modifiers that differ from what the client reported
+		if (Ar.IsLoading())
+		{
+			// SerializeBits only writes the bits it reads
+			ModifierMask = 0;
+			Modifiers.SetNum(NumCorrected, EAllowShrinking::No);
+			Expiries.SetNum(NumCorrected, EAllowShrinking::No);
+		}
+		Ar.SerializeBits(&ModifierMask, NumCorrected);
 
-		// Serialize ClientAuthAlpha
+		for (int32 i = 0; i < NumCorrected; ++i)
+		{
+			if (ModifierMask & (1u << i))
+			{
+				// The correction may be that the client should have no modifiers at all
+				const FModifierSlot& Slot = Registry.Slots[Registry.CorrectedSlots[i]];
+				const int32 NumLevels = Registry.GetSlotNumLevels(Registry.CorrectedSlots[i]);
+				bool bHasModifiers = Modifiers[i].Num() > 0 && NumLevels > 0;
+				Ar.SerializeBits(&bHasModifiers, 1);
+				if (bHasModifiers)
+				{
+					// TModifierStack has fixed inline storage, so the count must be bounded
+					FModifierStatics::NetSerializePacked(Modifiers[i], Ar, Slot.Name, NumLevels, MAX_MODIFIER_STACK_SIZE);
+				}
+				else if (Ar.IsLoading())
+				{
+					Modifiers[i].Reset();
+				}
+
+				// Timed modifiers are only sent with the stack, the client expires them by itself from then on
+				FModifierStatics::NetSerializeExpiries(Expiries[i], Ar, NumLevels);
+			}
+		}
+
+		// Serialize ClientAuthAlpha -- Quantized to 8 bits, the client only uses it to lerp towards its own location
 		Ar.SerializeBits(&bHasClientAuthAlpha, 1);
 		if (bHasClientAuthAlpha)
 		{
-			Ar << ClientAuthAlpha;
+			uint8 QuantizedAlpha = 0;
+			if (Ar.IsSaving())
+			{
+				// Never round down to 0, that would mean no authority
+				QuantizedAlpha = static_cast<uint8>(FMath::Clamp<int32>(FMath::RoundToInt(ClientAuthAlpha * 255.f), 1, 255));
+			}
+			Ar << QuantizedAlpha;
+			if (Ar.IsLoading())
+			{
+				ClientAuthAlpha = QuantizedAlpha / 255.f;
+			}
 		}
 		else if (!Ar.IsSaving())
 		{
@@ -113,11 +179,7 @@ void FModifierNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Charac
 	const FSavedMove_Character_Modifier& SavedMove = static_cast<const FSavedMove_Character_Modifier&>(ClientMove);
 
 	// Fill the Modifier data from the saved move
-	BoostLocal.ClientFillNetworkMoveData(SavedMove.BoostLocal.WantsModifiers);
-	BoostCorrection.ClientFillNetworkMoveData(SavedMove.BoostCorrection.WantsModifiers, SavedMove.BoostCorrection.Modifiers);
-	BoostServer.ClientFillNetworkMoveData(SavedMove.BoostServer.Modifiers);
-	SnareServer.ClientFillNetworkMoveData(SavedMove.SnareServer.Modifiers);
-	SlowFallLocal.ClientFillNetworkMoveData(SavedMove.SlowFallLocal.WantsModifiers);
+	Stacks = SavedMove.Stacks;
 }
 
 bool FModifierNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
@@ -125,16 +187,94 @@ bool FModifierNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterM
 {  // Client ➜ Server
 	Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
 
+	FPredictedMovementScopedNetBits ScopedNetBits(Ar, EPredictedNetFeature::ModifierMoveData);
+
+	// Pending and old moves are serialized after the new move in the same packet, and usually carry the same modifiers
+	// ServerMovePacked is unreliable, so referencing the new move is the only delta that is always available to the server
+	if (MoveType != ENetworkMoveType::NewMove)
+	{
+		const FModifierNetworkMoveData* NewMove = static_cast<const FModifierNetworkMoveData*>(
+			CharacterMovement.GetNetworkMoveDataContainer().GetNewMoveData());
+
+		bool bSameAsNewMove = Ar.IsSaving() && NewMove && Stacks == NewMove->Stacks;
+		Ar.SerializeBits(&bSameAsNewMove, 1);
+		if (bSameAsNewMove)
+		{
+			if (Ar.IsLoading() && NewMove)
+			{
+				Stacks = NewMove->Stacks;
+			}
+			return !Ar.IsError();
+		}
+	}
+
+	// The level counts determine how many bits each level is packed to, they must match between client and server
+	const UModifierMovement& MoveComp = static_cast<const UModifierMovement&>(CharacterMovement);
+	const FModifierRegistry& Registry = MoveComp.GetModifierRegistry();
+	Registry.InitStacks(Stacks);
+
+	// Every predicted slot sends WantsModifiers, followed by Modifiers of every corrected slot
+	const int32 NumPredicted = Registry.NumPredicted();
+	const int32 NumStacks = NumPredicted + Registry.NumCorrected();
+	static_assert(MAX_MODIFIER_SLOTS * 2 <= 64, "Presence mask is a uint64");
+
+	auto GetStack = [this, NumPredicted](int32 i) -> TModifierStack&
+	{
+		return i < NumPredicted ? Stacks.WantsModifiers[i] : Stacks.Modifiers[i - NumPredicted];
+	};
+
+	auto GetSlotIndex = [&Registry, NumPredicted](int32 i) -> int32
+	{
+		return i < NumPredicted ? Registry.PredictedSlots[i] : Registry.CorrectedSlots[i - NumPredicted];
+	};
+
+	// Presence bitmask up front, a single bit when no modifiers are active at all
+	uint64 PresenceMask = 0;
+	if (Ar.IsSaving())
+	{
+		for (int32 i = 0; i < NumStacks; ++i)
+		{
+			if (GetStack(i).Num() > 0 && Registry.GetSlotNumLevels(GetSlotIndex(i)) > 0)
+			{
+				PresenceMask |= 1ull << i;
+			}
+		}
+	}
+
+	bool bHasModifiers = PresenceMask != 0;
+	Ar.SerializeBits(&bHasModifiers, 1);
+	if (bHasModifiers)
+	{
+		Ar.SerializeBits(&PresenceMask, NumStacks);
+	}
+
 	// Serialize Modifier data
-	BoostLocal.Serialize(Ar, TEXT("BoostLocal"));
-	BoostCorrection.Serialize(Ar, TEXT("BoostCorrection"));
-	BoostServer.Serialize(Ar, TEXT("BoostServer"));
-	SnareServer.Serialize(Ar, TEXT("SnareServer"));
-	SlowFallLocal.Serialize(Ar, TEXT("SlowFallLocal"));
+	for (int32 i = 0; i < NumStacks; ++i)
+	{
+		if (PresenceMask & (1ull << i))
+		{
+			const int32 SlotIndex = GetSlotIndex(i);
+			FModifierStatics::NetSerializePacked(GetStack(i), Ar, Registry.Slots[SlotIndex].Name, Registry.GetSlotNumLevels(SlotIndex));
+		}
+		else if (Ar.IsLoading())
+		{
+			GetStack(i).Reset();
+		}
+	}
 
 	return !Ar.IsError();
 }
 
+#if WITH_EDITOR
+void UModifierMovement::PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// The families cache the level tables as well as the level methods and limits, rebuilding is cheap
+	BuildModifierLevelTables();
+}
+#endif
+
 bool UModifierMovement::HasValidData() const
 {
 	return Super::HasValidData() && IsValid(ModifierCharacterOwner);
@@ -145,6 +285,16 @@ void UModifierMovement::PostLoad()
 	Super::PostLoad();
 
 	ModifierCharacterOwner = Cast<AModifierCharacter>(PawnOwner);
+
+	BuildModifierLevelTables();
+}
+
+void UModifierMovement::OnRegister()
+{
+	Super::OnRegister();
+
+	// Spawned components are never loaded, and the maps may have been changed since
+	BuildModifierLevelTables();
 }
 
 void UModifierMovement::SetUpdatedComponent(USceneComponent* NewUpdatedComponent)
@@ -154,36 +304,116 @@ void UModifierMovement::SetUpdatedComponent(USceneComponent* NewUpdatedComponent
 	ModifierCharacterOwner = Cast<AModifierCharacter>(PawnOwner);
 }
 
+namespace ModifierMovementTables
+{
+	/**
+	 * Share the asset's table unless this component overrides the levels
+	 * @param bMergeShared If true, the overrides are layered on top of the shared levels, otherwise they replace them
+	 * @return The table to use
+	 */
+	template<typename TParams>
+	const TModifierLevelTable<TParams>* ResolveLevelTable(const TMap<FGameplayTag, TParams>& Overrides,
+		const TMap<FGameplayTag, TParams>& Shared, const TModifierLevelTable<TParams>& SharedTable,
+		TModifierLevelTable<TParams>& LocalTable, bool bMergeShared)
+	{
+		if (Overrides.IsEmpty())
+		{
+			// Free the memory from any previous override
+			LocalTable = TModifierLevelTable<TParams>();
+			return &SharedTable;
+		}
+
+		if (!bMergeShared)
+		{
+			LocalTable.Build(Overrides);
+			return &LocalTable;
+		}
+
+		TMap<FGameplayTag, TParams> Merged = Shared;
+		Merged.Append(Overrides);
+		LocalTable.Build(Merged);
+		return &LocalTable;
+	}
+}
+
+void UModifierMovement::BuildModifierLevelTables()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::BuildModifierLevelTables);
+
+	// Without an assigned asset, the overrides replace the defaults entirely, as the levels on this component did previously
+	const UModifierDataAsset* Data = GetModifierData();
+	const bool bMergeShared = ModifierData != nullptr;
+
+	BoostLevels = ModifierMovementTables::ResolveLevelTable(Boost, Data->Boost, Data->GetBoostLevels(), LocalBoostLevels, bMergeShared);
+	SnareLevels = ModifierMovementTables::ResolveLevelTable(Snare, Data->Snare, Data->GetSnareLevels(), LocalSnareLevels, bMergeShared);
+	SlowFallLevels = ModifierMovementTables::ResolveLevelTable(SlowFall, Data->SlowFall, Data->GetSlowFallLevels(), LocalSlowFallLevels, bMergeShared);
+
+	ModifierRegistry.Families[Family_Boost].SetLevels(*BoostLevels, GetBoostLevelMethod(), ShouldLimitMaxBoosts(), GetMaxBoosts());
+	ModifierRegistry.Families[Family_Snare].SetLevels(*SnareLevels, GetSnareLevelMethod(), ShouldLimitMaxSnares(), GetMaxSnares());
+	ModifierRegistry.Families[Family_SlowFall].SetLevels(*SlowFallLevels, GetSlowFallLevelMethod(), ShouldLimitMaxSlowFalls(), GetMaxSlowFalls());
+
+	// ModifierData may have changed the client auth params
+	InvalidateClientAuthParams();
+
+	UpdateModifierTableChecksum();
+}
+
+void UModifierMovement::UpdateModifierTableChecksum()
+{
+	uint32 Crc = 0;
+	for (const FModifierFamily& Family : ModifierRegistry.Families)
+	{
+		Crc = Family.Levels ? Family.Levels->GetChecksum(Crc) : Crc;
+	}
+	ModifierTableChecksum = Crc;
+
+	// Params are copied into the tables
+	InvalidateModifierParams();
+	InvalidateModifierProcessing();
+}
+
+bool UModifierMovement::VerifyModifierTableChecksum(uint32 ServerChecksum) const
+{
+	if (ServerChecksum == ModifierTableChecksum)
+	{
+		return true;
+	}
+
+	UE_LOG(LogModifierMovement, Error, TEXT("%s modifier level tables do not match the server (client 0x%08x, server 0x%08x). Boost, Snare and SlowFall levels must be identical on client and server builds."),
+		*GetNameSafe(CharacterOwner), ModifierTableChecksum, ServerChecksum);
+
+	ensureAlwaysMsgf(false, TEXT("Modifier level table mismatch, modifiers will de-sync"));
+	return false;
+}
+
 float UModifierMovement::GetMaxAcceleration() const
 {
-	return Super::GetMaxAcceleration() * GetBoostAccelScalar() * GetSnareAccelScalar();
+	return Super::GetMaxAcceleration() * GetEffectiveModifierParams().AccelScalar;
 }
 
 float UModifierMovement::GetMaxSpeed() const
 {
-	return Super::GetMaxSpeed() * GetBoostSpeedScalar() * GetSnareSpeedScalar();
+	return Super::GetMaxSpeed() * GetEffectiveModifierParams().SpeedScalar;
 }
 
 float UModifierMovement::GetMaxBrakingDeceleration() const
 {
-	return Super::GetMaxBrakingDeceleration() * GetBoostBrakingScalar() * GetSnareBrakingScalar();
+	return Super::GetMaxBrakingDeceleration() * GetEffectiveModifierParams().BrakingScalar;
 }
 
 float UModifierMovement::GetGroundFriction(float DefaultGroundFriction) const
 {
-	return GroundFriction * GetBoostGroundFrictionScalar() * GetSnareGroundFrictionScalar();
+	return GroundFriction * GetEffectiveModifierParams().GroundFrictionScalar;
 }
 
 float UModifierMovement::GetBrakingFriction() const
 {
-	return BrakingFriction * GetBoostBrakingFrictionScalar() * GetSnareBrakingFrictionScalar();
+	return BrakingFriction * GetEffectiveModifierParams().BrakingFrictionScalar;
 }
 
 float UModifierMovement::GetRootMotionTranslationScalar() const
 {
-	const float BoostScalar = BoostAffectsRootMotion() ? GetBoostSpeedScalar() : 1.f;
-	const float SnareScalar = SnareAffectsRootMotion() ? GetSnareSpeedScalar() : 1.f;
-	return BoostScalar * SnareScalar;
+	return GetEffectiveModifierParams().RootMotionScalar;
 }
 
 float UModifierMovement::GetGravityZ() const
@@ -193,9 +423,10 @@ float UModifierMovement::GetGravityZ() const
 
 FVector UModifierMovement::GetAirControl(float DeltaTime, float TickAirControl, const FVector& FallAcceleration)
 {
-	if (const FFallingModifierParams* SlowFallParams = GetSlowFallParams())
+	const FModifierEffectiveParams& Params = GetEffectiveModifierParams();
+	if (Params.bSlowFall)
 	{
-		TickAirControl = SlowFallParams->GetAirControl(TickAirControl);
+		TickAirControl = Params.SlowFall.GetAirControl(TickAirControl);
 	}
 	
 	return Super::GetAirControl(DeltaTime, TickAirControl, FallAcceleration);
@@ -243,8 +474,8 @@ bool UModifierMovement::RemoveVelocityZOnSlowFallStart() const
 	}
 	
 	// Optionally clear Z velocity if slow fall is active
-	const EModifierFallZ RemoveVelocityZ = GetSlowFallParams() ?
-		GetSlowFallParams()->RemoveVelocityZOnStart : EModifierFallZ::Disabled;
+	const FModifierEffectiveParams& Params = GetEffectiveModifierParams();
+	const EModifierFallZ RemoveVelocityZ = Params.bSlowFall ? Params.SlowFall.RemoveVelocityZOnStart : EModifierFallZ::Disabled;
 		
 	switch (RemoveVelocityZ)
 	{
@@ -261,77 +492,441 @@ bool UModifierMovement::RemoveVelocityZOnSlowFallStart() const
 	return false;
 }
 
+void UModifierMovement::ResolveEffectiveModifierParams(FModifierEffectiveParams& Params) const
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::ResolveEffectiveModifierParams);
+
+	Params = FModifierEffectiveParams();
+	Params.SetResolvedFor(ModifierRegistry);
+
+	// Boost and Snare scale the same movement properties
+	for (const FMovementModifierParams* ModifierParams : { GetBoostParams(), GetSnareParams() })
+	{
+		if (ModifierParams)
+		{
+			Params.SpeedScalar *= ModifierParams->MaxWalkSpeed;
+			Params.AccelScalar *= ModifierParams->MaxAcceleration;
+			Params.BrakingScalar *= ModifierParams->BrakingDeceleration;
+			Params.GroundFrictionScalar *= ModifierParams->GroundFriction;
+			Params.BrakingFrictionScalar *= ModifierParams->BrakingFriction;
+			Params.RootMotionScalar *= ModifierParams->bAffectsRootMotion ? ModifierParams->MaxWalkSpeed : 1.f;
+		}
+	}
+
+	if (const FFallingModifierParams* SlowFallParams = GetSlowFallParams())
+	{
+		Params.SlowFall = *SlowFallParams;
+		Params.bSlowFall = true;
+	}
+}
+
 void UModifierMovement::ProcessModifierMovementState()
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::ProcessModifierMovementState);
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::ProcessModifierMovementState);
 	
 	// Proxies get replicated Modifier state.
 	if (CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
 	{
+		const bool bRecording = IsRecordingResolvePasses();
+
+		// Timed modifiers expire at the start of the move, on both client and server
+		if (ResolvePass == EModifierResolvePass::BeforeMovement)
+		{
+			ExpireTimedModifiers();
+		}
+
 		// Check for a change in Modifier state. Players toggle Modifier by changing WantsModifier.
+		for (int32 FamilyIndex = 0; FamilyIndex < ModifierRegistry.Families.Num(); ++FamilyIndex)
+		{
+			FModifierFamily& Family = ModifierRegistry.Families[FamilyIndex];
+			const TModSize PrevLevelValue = *Family.Level;
+			const FGameplayTag PrevLevel = Family.GetLevelTag(PrevLevelValue);
+			const bool bAllowedInCurrentState = (this->*Family.CanActivate)();
+			const TArrayView<FMovementModifier* const> Modifiers = ModifierRegistry.GetFamilyModifiers(Family);
+
+			// Batched server moves may have resolved this already, and so may the saved move being replayed
+			bool bChanged = false;
+			bool bAdopted = false;
+			if (CurrentResolvedMove && CurrentResolvedMove->Families.IsValidIndex(FamilyIndex))
+			{
+				FModifierResolvedFamily& Resolved = CurrentResolvedMove->Families[FamilyIndex];
+				bAdopted = AdoptResolvedModifiers(*CurrentResolvedMove, Resolved, FamilyIndex, bAllowedInCurrentState, bChanged);
+
+				// Processing again after movement starts from the result, not the resolved inputs
+				Resolved.bValid = false;
+			}
+			else if (ReplayResolvePasses)
+			{
+				FModifierResolvedMove& Pass = ReplayResolvePasses[static_cast<int32>(ResolvePass)];
+				if (Pass.Revision == ModifierProcessRevision && Pass.Families.IsValidIndex(FamilyIndex))
+				{
+					bAdopted = AdoptResolvedModifiers(Pass, Pass.Families[FamilyIndex], FamilyIndex, bAllowedInCurrentState, bChanged);
+				}
+			}
 
-		{	// Boost
-			const FGameplayTag PrevBoostLevel = GetBoostLevel();
-			const uint8 PrevBoostLevelValue = BoostLevel;
-			const TArray<FMovementModifier*> Boosts = { &BoostLocal, &BoostCorrection, &BoostServer };
-			if (FModifierStatics::ProcessModifiers(BoostLevel, BoostLevelMethod, BoostLevels,
-				bLimitMaxBoosts, MaxBoosts, NO_MODIFIER, Boosts,
-				[this] { return CanBoostInCurrentState(); }))
+			if (!bAdopted)
 			{
-				ModifierCharacterOwner->NotifyModifierChanged(FModifierTags::Modifier_Boost,
-					GetBoostLevel(), PrevBoostLevel, BoostLevel,
-					PrevBoostLevelValue, NO_MODIFIER);
+				// Record the inputs, so replaying this move can adopt the result
+				FModifierResolvedFamily* Record = nullptr;
+				if (bRecording)
+				{
+					FModifierResolvedMove& Pass = RecordedResolvePasses[static_cast<int32>(ResolvePass)];
+					Pass.Revision = ModifierProcessRevision;
+					Pass.Families.SetNum(ModifierRegistry.Families.Num(), EAllowShrinking::No);
+					Record = &Pass.Families[FamilyIndex];
+					Record->InHash = FModifierStatics::HashModifiers(Modifiers);
+					Record->InLevel = *Family.Level;
+					Record->bAllowedInCurrentState = bAllowedInCurrentState;
+				}
+
+				bChanged = FModifierStatics::ProcessModifiers(*Family.Level, Family.Method, Family.Levels->Levels,
+					Family.bLimitMaxModifiers, Family.MaxModifiers, NO_MODIFIER, Modifiers,
+					[bAllowedInCurrentState] { return bAllowedInCurrentState; }, bSkipUnchangedModifiers ? &Family.ProcessCache : nullptr);
+
+				if (Record)
+				{
+					// Unchanged stacks don't need to be kept, replaying only restores the level
+					Record->OutModifiersIndex = INDEX_NONE;
+					if (bChanged)
+					{
+						RecordedResolvePasses[static_cast<int32>(ResolvePass)].SetOutModifiers(*Record, Modifiers);
+					}
+					Record->OutLevel = *Family.Level;
+					Record->bChanged = bChanged;
+					Record->bValid = true;
+				}
 			}
+			else if (bRecording)
+			{
+				RecordedResolvePasses[static_cast<int32>(ResolvePass)].Families.SetNum(ModifierRegistry.Families.Num(), EAllowShrinking::No);
+				RecordedResolvePasses[static_cast<int32>(ResolvePass)].Families[FamilyIndex].bValid = false;
+			}
+
+			if (bChanged)
+			{
+				ModifierCharacterOwner->NotifyModifierChanged(FamilyIndex, Family.Type,
+					Family.GetLevelTag(*Family.Level), PrevLevel, *Family.Level,
+					PrevLevelValue, NO_MODIFIER);
+			}
+		}
+	}
+}
+
+bool UModifierMovement::AdoptResolvedModifiers(const FModifierResolvedMove& Move, const FModifierResolvedFamily& Resolved,
+	int32 FamilyIndex, bool bAllowedInCurrentState, bool& bOutChanged)
+{
+	FModifierFamily& Family = ModifierRegistry.Families[FamilyIndex];
+	if (!Resolved.bValid || Resolved.bAllowedInCurrentState != bAllowedInCurrentState || Resolved.InLevel != *Family.Level)
+	{
+		return false;
+	}
+
+	// Only valid if the family is in the state it was resolved from
+	const TArrayView<FMovementModifier* const> Modifiers = ModifierRegistry.GetFamilyModifiers(Family);
+	if (Resolved.OutModifiersIndex != INDEX_NONE && !Move.OutModifiers.IsValidIndex(Resolved.OutModifiersIndex + Modifiers.Num() - 1))
+	{
+		return false;
+	}
+
+	if (FModifierStatics::HashModifiers(Modifiers) != Resolved.InHash)
+	{
+		return false;
+	}
+
+	if (Resolved.OutModifiersIndex != INDEX_NONE)
+	{
+		for (int32 i = 0; i < Modifiers.Num(); ++i)
+		{
+			Modifiers[i]->Modifiers = Move.OutModifiers[Resolved.OutModifiersIndex + i];
+		}
+	}
+	*Family.Level = Resolved.OutLevel;
+
+	if (bSkipUnchangedModifiers)
+	{
+		Family.ProcessCache.Update(*Family.Level, Family.Method, Family.Levels->Levels.Num(), Family.bLimitMaxModifiers,
+			Family.MaxModifiers, bAllowedInCurrentState, Modifiers);
+	}
+
+	bOutChanged = Resolved.bChanged;
+	return true;
+}
+
+void UModifierMovement::ExpireTimedModifiers()
+{
+	const float Timestamp = GetModifierTimestamp();
+
+	// The client rewinds its timestamp by MinTimeBetweenTimeStampResets regularly, and the server follows it
+	if (Timestamp < LastModifierExpiryTimestamp - MinTimeBetweenTimeStampResets * 0.5f)
+	{
+		for (const FModifierSlot& Slot : ModifierRegistry.Slots)
+		{
+			Slot.Modifier->RebaseExpiries(-MinTimeBetweenTimeStampResets);
 		}
+	}
+	LastModifierExpiryTimestamp = Timestamp;
 
-		{	// Snare
-			const FGameplayTag PrevSnareLevel = GetSnareLevel();
-			const uint8 PrevSnareLevelValue = SnareLevel;
-			const TArray<FMovementModifier*> Snares = { &SnareServer };
-			if (FModifierStatics::ProcessModifiers(SnareLevel, SnareLevelMethod, SnareLevels,
-				bLimitMaxSnares, MaxSnares, NO_MODIFIER, Snares,
-				[this] { return CanSnareInCurrentState(); }))
+	for (const FModifierSlot& Slot : ModifierRegistry.Slots)
+	{
+		Slot.Modifier->ExpireModifiers(Timestamp);
+	}
+}
+
+float UModifierMovement::GetModifierTimestamp() const
+{
+	if (CharacterOwner->GetLocalRole() == ROLE_Authority)
+	{
+		if (CharacterOwner->IsLocallyControlled() || CharacterOwner->GetRemoteRole() != ROLE_AutonomousProxy)
+		{
+			// Server owned character, or not controlled by a client
+			return GetWorld()->GetTimeSeconds();
+		}
+
+		// Server remote character, the timestamp of the move being performed
+		const FNetworkPredictionData_Server_Character* ServerData = GetPredictionData_Server_Character();
+		return ServerData->CurrentClientTimeStamp;
+	}
+
+	// Replaying moves doesn't advance the client's timestamp
+	if (bClientUpdating)
+	{
+		return ModifierReplayTimestamp;
+	}
+
+	// Client owned character
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+	return ClientData->CurrentTimeStamp;
+}
+
+float UModifierMovement::GetModifierExpiryTimestamp(float Duration) const
+{
+	return GetModifierTimestamp() + FMath::Clamp(Duration, 0.f, MinTimeBetweenTimeStampResets * 0.5f);
+}
+
+bool UModifierMovement::IsRecordingResolvePasses() const
+{
+	return !bClientUpdating && CharacterOwner->GetLocalRole() == ROLE_AutonomousProxy && IsNetMode(NM_Client);
+}
+
+void UModifierMovement::SnapshotQueuedServerMoves()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::SnapshotQueuedServerMoves);
+
+	ResolvedServerMoves.Reset();
+	QueuedStartModifiers.Reset();
+	NextResolvedMove = 0;
+
+	// Without a snapshot the moves are processed as usual
+	if (!HasValidData() || CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	// Pending and new moves in the order ServerMove_HandleMoveData performs them
+	// Old moves are not resolved, if one is performed the following moves no longer match and are processed as usual
+	for (const FModifierQueuedServerMoves& Queued : QueuedServerMoves)
+	{
+		for (const FModifierNetworkMoveData* MoveData : { Queued.bHasPendingMove ? &Queued.PendingMove : nullptr, &Queued.NewMove })
+		{
+			if (MoveData)
 			{
-				ModifierCharacterOwner->NotifyModifierChanged(FModifierTags::Modifier_Snare,
-					GetSnareLevel(), PrevSnareLevel, SnareLevel,
-					PrevSnareLevelValue, NO_MODIFIER);
+				FModifierResolvedMove& Resolved = ResolvedServerMoves.AddDefaulted_GetRef();
+				Resolved.MoveData = MoveData;
+				Resolved.TimeStamp = MoveData->TimeStamp;
+				Resolved.Families.SetNum(ModifierRegistry.Families.Num());
 			}
 		}
+	}
+
+	if (ResolvedServerMoves.Num() == 0)
+	{
+		return;
+	}
+
+	// The first move starts from the current state, CanActivate can only be evaluated on the game thread
+	QueuedStartModifiers.SetNum(ModifierRegistry.Families.Num());
+	for (int32 FamilyIndex = 0; FamilyIndex < ModifierRegistry.Families.Num(); ++FamilyIndex)
+	{
+		const FModifierFamily& Family = ModifierRegistry.Families[FamilyIndex];
+		const bool bAllowedInCurrentState = (this->*Family.CanActivate)();
+		for (FModifierResolvedMove& Resolved : ResolvedServerMoves)
+		{
+			Resolved.Families[FamilyIndex].bAllowedInCurrentState = bAllowedInCurrentState;
+		}
+
+		ResolvedServerMoves[0].Families[FamilyIndex].InLevel = *Family.Level;
+		for (const FMovementModifier* Modifier : ModifierRegistry.GetFamilyModifiers(Family))
+		{
+			QueuedStartModifiers[FamilyIndex].Add(*Modifier);
+		}
+	}
+}
+
+void UModifierMovement::PreResolveQueuedServerMoves()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::PreResolveQueuedServerMoves);
+
+	if (ResolvedServerMoves.Num() == 0)
+	{
+		return;
+	}
+
+	// Each family carries its state from one move to the next, as performing the moves would
+	for (int32 FamilyIndex = 0; FamilyIndex < ModifierRegistry.Families.Num(); ++FamilyIndex)
+	{
+		const FModifierFamily& Family = ModifierRegistry.Families[FamilyIndex];
+		TArray<FMovementModifier, TInlineAllocator<3>>& State = QueuedStartModifiers[FamilyIndex];
+		TModSize Level = ResolvedServerMoves[0].Families[FamilyIndex].InLevel;
+
+		TArray<FMovementModifier*, TInlineAllocator<3>> StateModifiers;
+		for (FMovementModifier& Modifier : State)
+		{
+			StateModifiers.Add(&Modifier);
+		}
 
-		{	// SlowFall
-			const FGameplayTag PrevSlowFallLevel = GetSlowFallLevel();
-			const uint8 PrevSlowFallLevelValue = SlowFallLevel;
-			const TArray<FMovementModifier*> SlowFalls = { &SlowFallLocal };
-			if (FModifierStatics::ProcessModifiers(SlowFallLevel, SlowFallLevelMethod, SlowFallLevels,
-				bLimitMaxSlowFalls, MaxSlowFalls, NO_MODIFIER, SlowFalls,
-				[this] { return CanSlowFallInCurrentState(); }))
+		for (FModifierResolvedMove& Resolved : ResolvedServerMoves)
+		{
+			// Apply the client's input, as ServerMove_PerformMovement does
+			for (int32 i = 0; i < Family.NumSlots; ++i)
 			{
-				ModifierCharacterOwner->NotifyModifierChanged(FModifierTags::Modifier_SlowFall,
-					GetSlowFallLevel(), PrevSlowFallLevel, SlowFallLevel,
-					PrevSlowFallLevelValue, NO_MODIFIER);
+				const FModifierSlot& Slot = ModifierRegistry.Slots[Family.FirstSlot + i];
+				if (Resolved.MoveData->Stacks.WantsModifiers.IsValidIndex(Slot.WantsIndex))
+				{
+					State[i].WantsModifiers = Resolved.MoveData->Stacks.WantsModifiers[Slot.WantsIndex];
+				}
 			}
+
+			FModifierResolvedFamily& Result = Resolved.Families[FamilyIndex];
+			Result.InHash = FModifierStatics::HashModifiers(StateModifiers);
+			Result.InLevel = Level;
+
+			const bool bAllowedInCurrentState = Result.bAllowedInCurrentState;
+			Result.bChanged = FModifierStatics::ProcessModifiers(Level, Family.Method, Family.Levels->Levels,
+				Family.bLimitMaxModifiers, Family.MaxModifiers, NO_MODIFIER, StateModifiers,
+				[bAllowedInCurrentState] { return bAllowedInCurrentState; });
+
+			Result.OutModifiersIndex = INDEX_NONE;
+			if (Result.bChanged)
+			{
+				Resolved.SetOutModifiers(Result, StateModifiers);
+			}
+			Result.OutLevel = Level;
+			Result.bValid = true;
+		}
+	}
+}
+
+void UModifierMovement::PerformQueuedServerMoves()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::PerformQueuedServerMoves);
+
+	{
+		TGuardValue<bool> PerformingGuard(bPerformingQueuedServerMoves, true);
+		for (const FModifierQueuedServerMoves& Queued : QueuedServerMoves)
+		{
+			*static_cast<FModifierNetworkMoveData*>(QueuedMoveDataContainer.GetNewMoveData()) = Queued.NewMove;
+			*static_cast<FModifierNetworkMoveData*>(QueuedMoveDataContainer.GetPendingMoveData()) = Queued.PendingMove;
+			*static_cast<FModifierNetworkMoveData*>(QueuedMoveDataContainer.GetOldMoveData()) = Queued.OldMove;
+			QueuedMoveDataContainer.bIsDualMove = Queued.bIsDualMove;
+			QueuedMoveDataContainer.bIsDualHybridRootMotionMove = Queued.bIsDualHybridRootMotionMove;
+			QueuedMoveDataContainer.bHasPendingMove = Queued.bHasPendingMove;
+			QueuedMoveDataContainer.bHasOldMove = Queued.bHasOldMove;
+			QueuedMoveDataContainer.bDisableCombinedScopedMove = Queued.bDisableCombinedScopedMove;
+
+			// The new move is performed last, see bEvaluateClientAuthPerPacket
+			ClientAuthPacketMoveData = QueuedMoveDataContainer.GetNewMoveData();
+
+			Super::ServerMove_HandleMoveData(QueuedMoveDataContainer);
+
+			ClientAuthPacketMoveData = nullptr;
 		}
 	}
+
+	QueuedServerMoves.Reset();
+	ResolvedServerMoves.Reset();
+	QueuedStartModifiers.Reset();
+	CurrentResolvedMove = nullptr;
+	NextResolvedMove = 0;
 }
 
 void UModifierMovement::UpdateModifierMovementState()
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::UpdateModifierMovementState);
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::UpdateModifierMovementState);
 	
 	if (!HasValidData())
 	{
 		return;
 	}
 
-	// Initialize Modifier levels if empty
-	if (BoostLevels.Num() == 0)	{ for (const auto& Level : Boost) { BoostLevels.Add(Level.Key); } }
-	if (SnareLevels.Num() == 0)	{ for (const auto& Level : Snare) { SnareLevels.Add(Level.Key); } }
-	if (SlowFallLevels.Num() == 0) { for (const auto& Level : SlowFall) { SlowFallLevels.Add(Level.Key); } }
-
 	// Update the modifiers
 	ProcessModifierMovementState();
 }
 
+void UModifierMovement::InvalidateModifierProcessing()
+{
+	ModifierProcessRevision++;
+
+	for (FModifierFamily& Family : ModifierRegistry.Families)
+	{
+		Family.ProcessCache.Invalidate();
+	}
+}
+
+TModSize UModifierMovement::ResolveWantedFamilyLevel(int32 FamilyIndex, const FModifierStacks& InStacks) const
+{
+	const FModifierFamily& Family = ModifierRegistry.Families[FamilyIndex];
+	if (!Family.Levels)
+	{
+		return NO_MODIFIER;
+	}
+
+	// Mirrors FModifierStatics::ProcessModifiers, without touching the modifiers
+	const TModSize MaxLevel = Family.NumLevels() > 0 ? static_cast<TModSize>(Family.NumLevels() - 1) : 0;
+
+	TModifierStack Levels;
+	int32 Remaining = Family.MaxModifiers;
+	for (int32 i = Family.FirstSlot; i < Family.FirstSlot + Family.NumSlots; ++i)
+	{
+		const FModifierSlot& Slot = ModifierRegistry.Slots[i];
+		TModifierStack Wants = Slot.WantsIndex != INDEX_NONE && InStacks.WantsModifiers.IsValidIndex(Slot.WantsIndex) ?
+			InStacks.WantsModifiers[Slot.WantsIndex] : Slot.Modifier->WantsModifiers;
+
+		if (Family.bLimitMaxModifiers)
+		{
+			FMovementModifier::LimitNumModifiers(Wants, Remaining);
+		}
+
+		const TModSize SlotLevel = FModifierStatics::UpdateModifierLevel(Family.Method, Wants, MaxLevel, NO_MODIFIER);
+		if (SlotLevel != NO_MODIFIER)
+		{
+			Levels.Add(SlotLevel);
+		}
+	}
+
+	return Levels.Num() > 0 ? FModifierStatics::CombineModifierLevels(Family.Method, Levels, MaxLevel, NO_MODIFIER) : NO_MODIFIER;
+}
+
+FMovementModifier* UModifierMovement::FindModifier(const FGameplayTag& Type, EModifierNetType NetType) const
+{
+	return FindModifier(ModifierRegistry.FindFamily(Type), NetType);
+}
+
+FMovementModifier* UModifierMovement::FindModifier(int32 FamilyIndex, EModifierNetType NetType) const
+{
+	const FModifierSlot* Slot = ModifierRegistry.FindSlot(FamilyIndex, NetType);
+	return Slot ? Slot->Modifier : nullptr;
+}
+
+TModSize UModifierMovement::GetModifierLevelIndex(const FGameplayTag& Type, const FGameplayTag& Level) const
+{
+	return GetModifierLevelIndex(ModifierRegistry.FindFamily(Type), Level);
+}
+
+TModSize UModifierMovement::GetModifierLevelIndex(int32 FamilyIndex, const FGameplayTag& Level) const
+{
+	return ModifierRegistry.Families.IsValidIndex(FamilyIndex) ? ModifierRegistry.Families[FamilyIndex].GetLevelIndex(Level) : NO_MODIFIER;
+}
+
 void UModifierMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 {
 	if (!HasValidData())
@@ -340,6 +935,7 @@ void UModifierMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 	}
 	
 	const bool bWasSlowFalling = IsSlowFallActive();
+	ResolvePass = EModifierResolvePass::BeforeMovement;
 	UpdateModifierMovementState();
 
 	if (CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
@@ -356,6 +952,7 @@ void UModifierMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 
 void UModifierMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
 {
+	ResolvePass = EModifierResolvePass::AfterMovement;
 	UpdateModifierMovementState();
 
 	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
@@ -363,30 +960,44 @@ void UModifierMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
 
 FClientAuthData* UModifierMovement::ProcessClientAuthData()
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::ProcessClientAuthData);
-	
-	ClientAuthStack.SortByPriority();
+	// The stack is kept in priority order on insert
 	return ClientAuthStack.GetFirst();
 }
 
+const FClientAuthParams* UModifierMovement::GetClientAuthParamsForSource(const FGameplayTag& Source) const
+{
+	if (const FClientAuthParams* Params = ClientAuthParams.Find(Source))
+	{
+		return Params;
+	}
+	return GetModifierData()->GetClientAuthParamsForSource(Source);
+}
+
 FClientAuthParams UModifierMovement::GetClientAuthParams(const FClientAuthData* ClientAuthData)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::GetClientAuthParams);
-	
 	if (!ClientAuthData)
 	{
 		return {};
 	}
 	
+	// Reuse the combined parameters until the stack changes
+	if (bClientAuthParamsCached && CachedClientAuthRevision == ClientAuthStack.GetRevision() &&
+		CachedClientAuthParams.Priority == ClientAuthData->Priority)
+	{
+		return CachedClientAuthParams;
+	}
+	
 	FClientAuthParams Params = { false, 0.f, 0.f, 0.f, ClientAuthData->Priority };
 
-	// Get all active client auth data that matches the priority
-	TArray<FClientAuthData> Priority = ClientAuthStack.FilterPriority(ClientAuthData->Priority);
-
-	// Combine the parameters
+	// Combine the parameters of all active client auth data that matches the priority
 	int32 Num = 0;
-	for (const FClientAuthData& Data : Priority)
+	for (const FClientAuthData& Data : ClientAuthStack.Stack)
 	{
+		if (Data.Priority != ClientAuthData->Priority)
+		{
+			continue;
+		}
+		
 		if (const FClientAuthParams* DataParams = GetClientAuthParamsForSource(Data.Source))
 		{
 			Params.ClientAuthTime += DataParams->ClientAuthTime;
@@ -405,12 +1016,16 @@ FClientAuthParams UModifierMovement::GetClientAuthParams(const FClientAuthData*
 		Params.RejectClientAuthDistance /= Num;
 	}
 
+	CachedClientAuthParams = Params;
+	CachedClientAuthRevision = ClientAuthStack.GetRevision();
+	bClientAuthParamsCached = true;
+
 	return Params;
 }
 
 void UModifierMovement::GrantClientAuthority(FGameplayTag ClientAuthSource, float OverrideDuration)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::GrantClientAuthority);
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::GrantClientAuthority);
 	
 	if (!CharacterOwner || !CharacterOwner->HasAuthority())
 	{
@@ -422,14 +1037,11 @@ void UModifierMovement::GrantClientAuthority(FGameplayTag ClientAuthSource, floa
 		if (Params->bEnableClientAuth)
 		{
 			const float Duration = OverrideDuration > 0.f ? OverrideDuration : Params->ClientAuthTime;
-			ClientAuthStack.Stack.Add(FClientAuthData(ClientAuthSource, Duration, Params->Priority, ++ClientAuthIdCounter));
 
-			// Limit the number of auth data entries
+			// Limited to MAX_CLIENT_AUTH_STACK_SIZE entries, the oldest is removed to make room
 			// IMPORTANT: We do not allow serializing more than 8, if this changes, update the serialization code too
-			if (ClientAuthStack.Stack.Num() > 8)
-			{
-				ClientAuthStack.Stack.RemoveAt(0);
-			}
+			ClientAuthStack.Push(FClientAuthData(ClientAuthSource, Duration, Params->Priority, ++ClientAuthIdCounter));
+			TRACE_PREDICTED_CLIENT_AUTH_GRANT(CharacterOwner, ClientAuthSource, Duration, Params->Priority);
 		}
 	}
 	else
@@ -442,9 +1054,19 @@ void UModifierMovement::GrantClientAuthority(FGameplayTag ClientAuthSource, floa
 	}
 }
 
+void UModifierMovement::SimulatedTick(float DeltaSeconds)
+{
+	if (ModifierCharacterOwner && ModifierCharacterOwner->HasDeferredModifierRep())
+	{
+		ModifierCharacterOwner->FlushDeferredModifierRep();
+	}
+
+	Super::SimulatedTick(DeltaSeconds);
+}
+
 bool UModifierMovement::ServerShouldGrantClientPositionAuthority(FVector& ClientLoc, FClientAuthData*& AuthData)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(UModifierMovement::ServerShouldGrantClientPositionAuthority);
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovement::ServerShouldGrantClientPositionAuthority);
 	
 	AuthData = nullptr;
 	
@@ -492,41 +1114,109 @@ bool UModifierMovement::ServerShouldGrantClientPositionAuthority(FVector& Client
 	AuthData->Alpha = 0.f;
 
 	// How far the client is from the server
+	// Compared squared, the only square root taken is for the partial alpha
 	const FVector ServerLoc = UpdatedComponent->GetComponentLocation();
-	FVector LocDiff = ServerLoc - ClientLoc;
+	const FVector LocDiff = ServerLoc - ClientLoc;
+	const float DistSq = LocDiff.SizeSquared();
 
 	// No change or almost no change occurred
-	if (LocDiff.IsNearlyZero())
+	if (DistSq <= UE_KINDA_SMALL_NUMBER)
 	{
 		// Grant full authority
 		AuthData->Alpha = 1.f;
+		PredictedMovementStats::RecordClientAuth(EPredictedClientAuthOutcome::Full);
+		TRACE_PREDICTED_CLIENT_AUTH(CharacterOwner, EPredictedClientAuthOutcome::Full, AuthData->Alpha, FMath::Sqrt(DistSq));
 		return true;
 	}
 
 	// If the client is too far away from the server, reject the client position entirely, potential cheater
-	if (LocDiff.SizeSquared() >= FMath::Square(Params.RejectClientAuthDistance))
+	if (DistSq >= FMath::Square(Params.RejectClientAuthDistance))
 	{
+		PredictedMovementStats::RecordClientAuth(EPredictedClientAuthOutcome::Rejected);
+		TRACE_PREDICTED_CLIENT_AUTH(CharacterOwner, EPredictedClientAuthOutcome::Rejected, 0.f, FMath::Sqrt(DistSq));
 		OnClientAuthRejected(ClientLoc, ServerLoc, LocDiff);
 		return false;
 	}
 
 	// If the client is not within the maximum allowable distance, accept the client position, but only partially
-	if (LocDiff.Size() >= Params.MaxClientAuthDistance)
+	if (DistSq >= FMath::Square(Params.MaxClientAuthDistance))
 	{
 		// Accept only a portion of the client's location
-		AuthData->Alpha = Params.MaxClientAuthDistance / LocDiff.Size();
+		AuthData->Alpha = Params.MaxClientAuthDistance * FMath::InvSqrt(DistSq);
 		ClientLoc = FMath::Lerp<FVector>(ServerLoc, ClientLoc, AuthData->Alpha);
-		LocDiff = ServerLoc - ClientLoc;
+		PredictedMovementStats::RecordClientAuth(EPredictedClientAuthOutcome::Partial);
+		TRACE_PREDICTED_CLIENT_AUTH(CharacterOwner, EPredictedClientAuthOutcome::Partial, AuthData->Alpha, FMath::Sqrt(DistSq));
 	}
 	else
 	{
 		// Accept full client location
 		AuthData->Alpha = 1.f;
+		PredictedMovementStats::RecordClientAuth(EPredictedClientAuthOutcome::Full);
+		TRACE_PREDICTED_CLIENT_AUTH(CharacterOwner, EPredictedClientAuthOutcome::Full, AuthData->Alpha, FMath::Sqrt(DistSq));
 	}
 
 	return true;
 }
 
+void UModifierMovement::CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove,
+	const FSavedMove_Character* OldMove)
+{
+	// The move data container is serialized with the engine's FNetBitWriter
+	const FPredictedMovementScopedNetWriter ScopedNetWriter;
+	Super::CallServerMovePacked(NewMove, PendingMove, OldMove);
+}
+
+void UModifierMovement::ServerSendMoveResponse(const FClientAdjustment& PendingAdjustment)
+{
+	// The move response container is serialized with the engine's FNetBitWriter
+	const FPredictedMovementScopedNetWriter ScopedNetWriter;
+	Super::ServerSendMoveResponse(PendingAdjustment);
+}
+
+void UModifierMovement::ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer)
+{
+	// Client >> CallServerMovePacked ➜ ClientFillNetworkMoveData ➜ ServerMovePacked_ClientSend >> Server
+	// >> ServerMovePacked_ServerReceive ➜ ServerMove_HandleMoveData ➜ Queue ➜ UModifierMovementSubsystem::Tick
+
+	if (!bPerformingQueuedServerMoves && UModifierMovementSubsystem::IsBatchingServerMoves() && CanBatchServerMoves())
+	{
+		if (UModifierMovementSubsystem* Subsystem = GetWorld() ? GetWorld()->GetSubsystem<UModifierMovementSubsystem>() : nullptr)
+		{
+			if (!HasQueuedServerMoves())
+			{
+				Subsystem->AddPendingMovement(this);
+			}
+
+			// Copy the moves, the container is reused by the next move received
+			FModifierQueuedServerMoves& Queued = QueuedServerMoves.AddDefaulted_GetRef();
+			Queued.NewMove = *static_cast<const FModifierNetworkMoveData*>(MoveDataContainer.GetNewMoveData());
+			Queued.PendingMove = *static_cast<const FModifierNetworkMoveData*>(MoveDataContainer.GetPendingMoveData());
+			Queued.OldMove = *static_cast<const FModifierNetworkMoveData*>(MoveDataContainer.GetOldMoveData());
+			Queued.bIsDualMove = MoveDataContainer.bIsDualMove;
+			Queued.bIsDualHybridRootMotionMove = MoveDataContainer.bIsDualHybridRootMotionMove;
+			Queued.bHasPendingMove = MoveDataContainer.bHasPendingMove;
+			Queued.bHasOldMove = MoveDataContainer.bHasOldMove;
+			Queued.bDisableCombinedScopedMove = MoveDataContainer.bDisableCombinedScopedMove;
+			return;
+		}
+	}
+
+	// Batching was disabled with moves still queued, they must be performed first to keep the moves in order
+	if (!bPerformingQueuedServerMoves && HasQueuedServerMoves())
+	{
+		SnapshotQueuedServerMoves();
+		PreResolveQueuedServerMoves();
+		PerformQueuedServerMoves();
+	}
+
+	// The new move is performed last, see bEvaluateClientAuthPerPacket
+	ClientAuthPacketMoveData = MoveDataContainer.GetNewMoveData();
+
+	Super::ServerMove_HandleMoveData(MoveDataContainer);
+
+	ClientAuthPacketMoveData = nullptr;
+}
+
 void UModifierMovement::ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData)
 {
 	// Server updates from the client's move data
@@ -537,12 +1227,20 @@ void UModifierMovement::ServerMove_PerformMovement(const FCharacterNetworkMoveDa
 	
 	const FModifierNetworkMoveData& ModifierMoveData = static_cast<const FModifierNetworkMoveData&>(MoveData);
 
-	BoostLocal.ServerMove_PerformMovement(ModifierMoveData.BoostLocal.WantsModifiers);
-	BoostCorrection.ServerMove_PerformMovement(ModifierMoveData.BoostCorrection.WantsModifiers);
+	// Apply the client's input to every predicted slot
+	ModifierRegistry.ApplyWantsModifiers(ModifierMoveData.Stacks);
 
-	SlowFallLocal.ServerMove_PerformMovement(ModifierMoveData.SlowFallLocal.WantsModifiers);
+	// Batched moves were resolved ahead of time, old moves were not
+	CurrentResolvedMove = nullptr;
+	if (bPerformingQueuedServerMoves && ResolvedServerMoves.IsValidIndex(NextResolvedMove) &&
+		ResolvedServerMoves[NextResolvedMove].TimeStamp == MoveData.TimeStamp)
+	{
+		CurrentResolvedMove = &ResolvedServerMoves[NextResolvedMove++];
+	}
 
 	Super::ServerMove_PerformMovement(MoveData);
+
+	CurrentResolvedMove = nullptr;
 }
 
 bool UModifierMovement::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel,
@@ -552,19 +1250,30 @@ bool UModifierMovement::ServerCheckClientError(float ClientTimeStamp, float Delt
 	// ServerMovePacked_ServerReceive ➜ ServerMove_HandleMoveData ➜ ServerMove_PerformMovement
 	// ➜ ServerMoveHandleClientError ➜ ServerCheckClientError
 	
+	// Trigger a client correction if the value in the Client differs
+	// Always test every stack, the move response only sends the ones that differ even if the base check also fails
+	const FModifierNetworkMoveData* CurrentMoveData = static_cast<const FModifierNetworkMoveData*>(GetCurrentNetworkMoveData());
+
+	ClientModifierErrorMask = 0;
+	for (int32 i = 0; i < ModifierRegistry.NumCorrected(); ++i)
+	{
+		const FMovementModifier* Modifier = ModifierRegistry.Slots[ModifierRegistry.CorrectedSlots[i]].Modifier;
+		if (!CurrentMoveData->Stacks.Modifiers.IsValidIndex(i) || Modifier->Modifiers != CurrentMoveData->Stacks.Modifiers[i])
+		{
+			ClientModifierErrorMask |= 1u << i;
+			PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::Modifier, ModifierRegistry.Slots[ModifierRegistry.CorrectedSlots[i]].Name);
+			TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::Modifier, ModifierRegistry.Slots[ModifierRegistry.CorrectedSlots[i]].Name, ClientTimeStamp);
+		}
+	}
+
 	if (Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode))
 	{
+		PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::Movement);
+		TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::Movement, nullptr, ClientTimeStamp);
 		return true;
 	}
-    
-	// Trigger a client correction if the value in the Client differs
-	const FModifierNetworkMoveData* CurrentMoveData = static_cast<const FModifierNetworkMoveData*>(GetCurrentNetworkMoveData());
 
-	if (BoostCorrection.ServerCheckClientError(CurrentMoveData->BoostCorrection.Modifiers))	{ return true; }
-	if (BoostServer.ServerCheckClientError(CurrentMoveData->BoostServer.Modifiers)) { return true; }
-	if (SnareServer.ServerCheckClientError(CurrentMoveData->SnareServer.Modifiers)) { return true; }
-
-	return false;
+	return ClientModifierErrorMask != 0;
 }
 
 void UModifierMovement::ServerMoveHandleClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel,
@@ -585,21 +1294,33 @@ void UModifierMovement::ServerMoveHandleClientError(float ClientTimeStamp, float
 		// Update client authority time remaining
 		ClientAuthStack.Update(DeltaTime);
 
-		// Test for client authority
-		FVector ClientLoc = FRepMovement::RebaseOntoZeroOrigin(RelativeClientLocation, this);
-		FClientAuthData* AuthData = nullptr;
-		if (ServerShouldGrantClientPositionAuthority(ClientLoc, AuthData))
+		// Nothing to test for the vast majority of moves, where no authority was granted
+		if (ClientAuthStack.Stack.Num() == 0)
 		{
-			// Apply client authoritative position directly -- Subsequent moves will resolve overlapping conditions
-			UpdatedComponent->SetWorldLocation(ClientLoc, false);
+			ClientAuthAlpha = 0.f;
 		}
+		// When evaluating per packet, only the new move is tested, the pending move before it only spends time
+		else if (IsClientAuthEvaluatedForCurrentMove())
+		{
+			// Test for client authority
+			FVector ClientLoc = FRepMovement::RebaseOntoZeroOrigin(RelativeClientLocation, this);
+			FClientAuthData* AuthData = nullptr;
+			if (ServerShouldGrantClientPositionAuthority(ClientLoc, AuthData))
+			{
+				// Apply client authoritative position directly -- Subsequent moves will resolve overlapping conditions
+				UpdatedComponent->SetWorldLocation(ClientLoc, false);
+			}
 
-		// Cached to be sent to the client later with FMoveResponseDataContainer
-		ClientAuthAlpha = AuthData ? AuthData->Alpha : 0.f;
+			// Cached to be sent to the client later with FMoveResponseDataContainer
+			ClientAuthAlpha = AuthData ? AuthData->Alpha : 0.f;
+		}
 	}
 
 	// The move prepared here will finally be sent in the next ReplicateMoveToServer()
 
+	// ServerCheckClientError() is skipped for forced updates and acceptable falling errors, send every stack unless it runs
+	ClientModifierErrorMask = FModifierMoveResponseDataContainer::Mask_All;
+
 	Super::ServerMoveHandleClientError(ClientTimeStamp, DeltaTime, Accel, RelativeClientLocation, ClientMovementBase,
 		ClientBaseBoneName, ClientMovementMode);
 }
@@ -642,9 +1363,29 @@ void UModifierMovement::OnClientCorrectionReceived(class FNetworkPredictionData_
 	
 	const FModifierMoveResponseDataContainer& MoveResponse = static_cast<const FModifierMoveResponseDataContainer&>(GetMoveResponseDataContainer());
 
-	BoostCorrection.OnClientCorrectionReceived(MoveResponse.BoostCorrection.Modifiers);
-	BoostServer.OnClientCorrectionReceived(MoveResponse.BoostServer.Modifiers);
-	SnareServer.OnClientCorrectionReceived(MoveResponse.SnareServer.Modifiers);
+	// Stacks that weren't sent matched what we reported in the move being corrected, which has already been acked
+	const FSavedMove_Character_Modifier* AckedMove = static_cast<const FSavedMove_Character_Modifier*>(ClientData.LastAckedMove.Get());
+
+	// Corrected slots take the server's Modifiers as their WantsModifiers
+	for (int32 i = 0; i < ModifierRegistry.NumCorrected(); ++i)
+	{
+		FMovementModifier* Modifier = ModifierRegistry.Slots[ModifierRegistry.CorrectedSlots[i]].Modifier;
+		if ((MoveResponse.ModifierMask & (1u << i)) && MoveResponse.Modifiers.IsValidIndex(i))
+		{
+			Modifier->WantsModifiers = MoveResponse.Modifiers[i];
+			if (MoveResponse.Expiries.IsValidIndex(i))
+			{
+				Modifier->Expiries = MoveResponse.Expiries[i];
+			}
+		}
+		else if (AckedMove && AckedMove->Stacks.Modifiers.IsValidIndex(i))
+		{
+			Modifier->WantsModifiers = AckedMove->Stacks.Modifiers[i];
+		}
+
+		// Any timed entry the server has since removed
+		Modifier->TrimExpiries();
+	}
 
 	Super::OnClientCorrectionReceived(ClientData, TimeStamp, UpdatedComponent->GetComponentLocation(), NewVelocity, NewBase, NewBaseBoneName,
 		bHasBase, bBaseRelativePosition, ServerMovementMode, ServerGravityDirection);
@@ -652,17 +1393,15 @@ void UModifierMovement::OnClientCorrectionReceived(class FNetworkPredictionData_
 
 bool UModifierMovement::ClientUpdatePositionAfterServerUpdate()
 {
-	const TModifierStack RealBoostLocal = BoostLocal.WantsModifiers;
-	const TModifierStack RealBoostCorrection = BoostCorrection.WantsModifiers;
-	const TModifierStack RealSlowFallLocal = SlowFallLocal.WantsModifiers;
+	FModifierStacks RealStacks;
+	ModifierRegistry.GatherWantsModifiers(RealStacks);
 
 	const FVector ClientLoc = UpdatedComponent->GetComponentLocation();
 	
 	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
 	
-	BoostLocal.WantsModifiers = RealBoostLocal;
-	BoostCorrection.WantsModifiers = RealBoostCorrection;
-	SlowFallLocal.WantsModifiers = RealSlowFallLocal;
+	ModifierRegistry.ApplyWantsModifiers(RealStacks);
+	ReplayResolvePasses = nullptr;
 
 	// Preserve client location relative to the partial client authority we have
 	const FVector AuthLocation = FMath::Lerp<FVector>(UpdatedComponent->GetComponentLocation(), ClientLoc, ClientAuthAlpha);
@@ -674,74 +1413,36 @@ bool UModifierMovement::ClientUpdatePositionAfterServerUpdate()
 void UModifierMovement::TickCharacterPose(float DeltaTime)
 {
 	/*
-	 * ACharacter::GetAnimRootMotionTranslationScale() is non-virtual, so we have to duplicate the entire function.
-	 * All we do here is scale CharacterOwner->GetAnimRootMotionTranslationScale() by GetRootMotionTranslationScalar()
-	 * 
+	 * ACharacter::GetAnimRootMotionTranslationScale() is non-virtual, so we scale the character's translation scale
+	 * by GetRootMotionTranslationScalar() for the duration of the base TickCharacterPose() instead
+	 *
 	 * This allows our snares to affect root motion.
 	 */
-	
-	if (DeltaTime < MIN_TICK_TIME)
-	{
-		return;
-	}
-
-	check(CharacterOwner && CharacterOwner->GetMesh());
-	USkeletalMeshComponent* CharacterMesh = CharacterOwner->GetMesh();
 
-	// bAutonomousTickPose is set, we control TickPose from the Character's Movement and Networking updates, and bypass the Component's update.
-	// (Or Simulating Root Motion for remote clients)
-	CharacterMesh->bIsAutonomousTickPose = true;
-
-	if (CharacterMesh->ShouldTickPose())
+	// No modifier affects root motion
+	const float Scalar = GetRootMotionTranslationScalar();
+	if (Scalar == 1.f || !CharacterOwner)
 	{
-		// Keep track of if we're playing root motion, just in case the root motion montage ends this frame.
-		const bool bWasPlayingRootMotion = CharacterOwner->IsPlayingRootMotion();
-
-		CharacterMesh->TickPose(DeltaTime, true);
-
-		// Grab root motion now that we have ticked the pose
-		if (CharacterOwner->IsPlayingRootMotion() || bWasPlayingRootMotion)
-		{
-			FRootMotionMovementParams RootMotion = CharacterMesh->ConsumeRootMotion();
-			if (RootMotion.bHasRootMotion)
-			{
-				RootMotion.ScaleRootMotionTranslation(CharacterOwner->GetAnimRootMotionTranslationScale() * GetRootMotionTranslationScalar());
-				RootMotionParams.Accumulate(RootMotion);
-			}
-
-#if !(UE_BUILD_SHIPPING)
-			// Debugging
-			{
-				const FAnimMontageInstance* RootMotionMontageInstance = CharacterOwner->GetRootMotionAnimMontageInstance();
-				UE_LOG(LogRootMotion, Log, TEXT("UCharacterMovementComponent::TickCharacterPose Role: %s, RootMotionMontage: %s, MontagePos: %f, DeltaTime: %f, ExtractedRootMotion: %s, AccumulatedRootMotion: %s")
-					, *UEnum::GetValueAsString(TEXT("Engine.ENetRole"), CharacterOwner->GetLocalRole())
-					, *GetNameSafe(RootMotionMontageInstance ? RootMotionMontageInstance->Montage : NULL)
-					, RootMotionMontageInstance ? RootMotionMontageInstance->GetPosition() : -1.f
-					, DeltaTime
-					, *RootMotion.GetRootMotionTransform().GetTranslation().ToCompactString()
-					, *RootMotionParams.GetRootMotionTransform().GetTranslation().ToCompactString()
-					);
-			}
-#endif // !(UE_BUILD_SHIPPING)
-		}
+		Super::TickCharacterPose(DeltaTime);
+		return;
 	}
 
-	CharacterMesh->bIsAutonomousTickPose = false;
+	const float TranslationScale = CharacterOwner->GetAnimRootMotionTranslationScale();
+	CharacterOwner->SetAnimRootMotionTranslationScale(TranslationScale * Scalar);
+	Super::TickCharacterPose(DeltaTime);
+	CharacterOwner->SetAnimRootMotionTranslationScale(TranslationScale);
 }
 
 void FSavedMove_Character_Modifier::Clear()
 {
 	Super::Clear();
 
-	BoostLocal.Clear();
-	BoostCorrection.Clear();
-	BoostServer.Clear();
-	SnareServer.Clear();
-	SlowFallLocal.Clear();
-
-	BoostLevel = NO_MODIFIER;
-	SnareLevel = NO_MODIFIER;
-	SlowFallLevel = NO_MODIFIER;
+	Stacks.Reset();
+	Levels.Reset();
+	for (FModifierResolvedMove& Pass : ResolvePasses)
+	{
+		Pass.Reset();
+	}
 }
 
 void FSavedMove_Character_Modifier::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel,
@@ -753,10 +1454,10 @@ void FSavedMove_Character_Modifier::SetMoveFor(ACharacter* C, float InDeltaTime,
 
 	if (const UModifierMovement* MoveComp = Cast<AModifierCharacter>(C)->GetModifierCharacterMovement())
 	{
-		BoostLocal.SetMoveFor(MoveComp->BoostLocal.WantsModifiers);
-		BoostCorrection.SetMoveFor(MoveComp->BoostCorrection.WantsModifiers);
-		SlowFallLocal.SetMoveFor(MoveComp->SlowFallLocal.WantsModifiers);
+		MoveComp->GetModifierRegistry().GatherWantsModifiers(Stacks);
 	}
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::SetMoveFor, TimeStamp, DeltaTime);
 }
 
 bool FSavedMove_Character_Modifier::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter,
@@ -781,17 +1482,82 @@ bool FSavedMove_Character_Modifier::CanCombineWith(const FSavedMovePtr& NewMove,
 	// We can only combine moves if they will result in the same state as if both moves were processed individually,
 	// because the AutonomousProxy Client processes them individually prior to sending them to the server.
 
-	if (!BoostLocal.CanCombineWith(SavedMove->BoostLocal.WantsModifiers)) { return false; }
-	if (!BoostCorrection.CanCombineWith(SavedMove->BoostCorrection.WantsModifiers)) { return false; }
+	const UModifierMovement* MoveComp = InCharacter ? Cast<UModifierMovement>(InCharacter->GetCharacterMovement()) : nullptr;
+	if (MoveComp && MoveComp->ModifierCombinePolicy == EModifierCombinePolicy::Relaxed)
+	{
+		return CanCombineWithRelaxed(*SavedMove, *MoveComp, NewMove, InCharacter, MaxDelta);
+	}
 
-	if (!SlowFallLocal.CanCombineWith(SavedMove->SlowFallLocal.WantsModifiers)) { return false; }
+	if (Stacks.WantsModifiers != SavedMove->Stacks.WantsModifiers)
+	{
+		return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedWantsModifiers, TimeStamp);
+	}
 
 	// Without these, the change/start/stop events will trigger twice causing de-sync, so we don't combine moves if the level changes
-	if (BoostLevel != SavedMove->BoostLevel) { return false; }
-	if (SnareLevel != SavedMove->SnareLevel) { return false; }
-	if (SlowFallLevel != SavedMove->SlowFallLevel) { return false; }
+	if (Levels != SavedMove->Levels)
+	{
+		return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedModifierLevels, TimeStamp);
+	}
 	
-	return FSavedMove_Character::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	const bool bCanCombine = FSavedMove_Character::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	return ReportPredictedCombine(InCharacter, bCanCombine ? EPredictedCombineResult::Combined : EPredictedCombineResult::RejectedBase, TimeStamp);
+}
+
+bool FSavedMove_Character_Modifier::CanCombineWithRelaxed(const FSavedMove_Character_Modifier& NewMove,
+	const UModifierMovement& MoveComp, const FSavedMovePtr& NewMovePtr, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FModifierRegistry& Registry = MoveComp.GetModifierRegistry();
+	if (Levels.Num() != NewMove.Levels.Num() || Stacks.WantsModifiers.Num() != NewMove.Stacks.WantsModifiers.Num())
+	{
+		return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedModifierLevels, TimeStamp);
+	}
+
+	bool bRelaxed = false;
+	for (int32 FamilyIndex = 0; FamilyIndex < Registry.Families.Num(); ++FamilyIndex)
+	{
+		const FModifierFamily& Family = Registry.Families[FamilyIndex];
+
+		// Server initiated levels arrive with the move response and don't depend on what this move sends
+		bool bPredicted = false;
+		bool bWantsDiffer = false;
+		for (int32 i = Family.FirstSlot; i < Family.FirstSlot + Family.NumSlots; ++i)
+		{
+			const int32 WantsIndex = Registry.Slots[i].WantsIndex;
+			if (WantsIndex != INDEX_NONE)
+			{
+				bPredicted = true;
+				bWantsDiffer |= Stacks.WantsModifiers[WantsIndex] != NewMove.Stacks.WantsModifiers[WantsIndex];
+			}
+		}
+
+		if (!bPredicted)
+		{
+			bRelaxed |= Levels[FamilyIndex] != NewMove.Levels[FamilyIndex];
+			continue;
+		}
+
+		// The level changed during this move, combining would skip the events for it
+		if (Levels[FamilyIndex] != NewMove.Levels[FamilyIndex])
+		{
+			return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedModifierLevels, TimeStamp);
+		}
+
+		// Different input is fine as long as the level it results in is the same
+		if (bWantsDiffer)
+		{
+			if (MoveComp.ResolveWantedFamilyLevel(FamilyIndex, Stacks) != MoveComp.ResolveWantedFamilyLevel(FamilyIndex, NewMove.Stacks))
+			{
+				return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedWantsModifiers, TimeStamp);
+			}
+			bRelaxed = true;
+		}
+	}
+
+	if (!FSavedMove_Character::CanCombineWith(NewMovePtr, InCharacter, MaxDelta))
+	{
+		return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedBase, TimeStamp);
+	}
+	return ReportPredictedCombine(InCharacter, bRelaxed ? EPredictedCombineResult::CombinedRelaxed : EPredictedCombineResult::Combined, TimeStamp);
 }
 
 void FSavedMove_Character_Modifier::SetInitialPosition(ACharacter* C)
@@ -804,13 +1570,14 @@ void FSavedMove_Character_Modifier::SetInitialPosition(ACharacter* C)
 	// Retrieve the value from our CMC to revert the saved move value back to this.
 	if (const UModifierMovement* MoveComp = Cast<AModifierCharacter>(C)->GetModifierCharacterMovement())
 	{
-		BoostLocal.SetInitialPosition(MoveComp->BoostLocal.WantsModifiers);
-		BoostCorrection.SetInitialPosition(MoveComp->BoostCorrection.WantsModifiers);
-		SlowFallLocal.SetInitialPosition(MoveComp->SlowFallLocal.WantsModifiers);
+		const FModifierRegistry& Registry = MoveComp->GetModifierRegistry();
+		Registry.GatherWantsModifiers(Stacks);
 
-		BoostLevel = MoveComp->BoostLevel;
-		SnareLevel = MoveComp->SnareLevel;
-		SlowFallLevel = MoveComp->SlowFallLevel;
+		Levels.SetNum(Registry.Families.Num(), EAllowShrinking::No);
+		for (int32 i = 0; i < Registry.Families.Num(); ++i)
+		{
+			Levels[i] = *Registry.Families[i].Level;
+		}
 	}
 }
 
@@ -823,14 +1590,18 @@ void FSavedMove_Character_Modifier::CombineWith(const FSavedMove_Character* OldM
 
 	if (UModifierMovement* MoveComp = C ? Cast<UModifierMovement>(C->GetCharacterMovement()) : nullptr)
 	{
-		MoveComp->BoostLocal.CombineWith(SavedOldMove->BoostLocal.WantsModifiers);
-		MoveComp->BoostCorrection.CombineWith(SavedOldMove->BoostCorrection.WantsModifiers);
-		MoveComp->SlowFallLocal.CombineWith(SavedOldMove->SlowFallLocal.WantsModifiers);
+		// The combined move is sent with our WantsModifiers, they only differ from the old move's with EModifierCombinePolicy::Relaxed
+		const FModifierRegistry& Registry = MoveComp->GetModifierRegistry();
+		Registry.ApplyWantsModifiers(Stacks);
 
-		MoveComp->BoostLevel = SavedOldMove->BoostLevel;
-		MoveComp->SnareLevel = SavedOldMove->SnareLevel;
-		MoveComp->SlowFallLevel = SavedOldMove->SlowFallLevel;
+		const int32 NumLevels = FMath::Min(Registry.Families.Num(), SavedOldMove->Levels.Num());
+		for (int32 i = 0; i < NumLevels; ++i)
+		{
+			*Registry.Families[i].Level = SavedOldMove->Levels[i];
+		}
 	}
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::CombineWith, TimeStamp, DeltaTime);
 }
 
 void FSavedMove_Character_Modifier::PostUpdate(ACharacter* C, EPostUpdateMode PostUpdateMode)
@@ -838,14 +1609,40 @@ void FSavedMove_Character_Modifier::PostUpdate(ACharacter* C, EPostUpdateMode Po
 	// When considering whether to delay or combine moves, we need to compare the move at the start and the end
 	if (const UModifierMovement* MoveComp = C ? Cast<UModifierMovement>(C->GetCharacterMovement()) : nullptr)
 	{
-		BoostCorrection.PostUpdate(MoveComp->BoostCorrection.Modifiers);
-		BoostServer.PostUpdate(MoveComp->BoostServer.Modifiers);
-		SnareServer.PostUpdate(MoveComp->SnareServer.Modifiers);
+		MoveComp->GetModifierRegistry().GatherModifiers(Stacks);
 
-		// if (PostUpdateMode == PostUpdate_Record)
+		// Keep how the move was resolved for replays, combined moves record again from the combined start
+		if (PostUpdateMode == PostUpdate_Record)
+		{
+			const FModifierResolvedMove* Recorded = MoveComp->GetRecordedResolvePasses();
+			for (int32 i = 0; i < static_cast<int32>(EModifierResolvePass::Num); ++i)
+			{
+				ResolvePasses[i] = Recorded[i];
+			}
+		}
 	}
 
 	Super::PostUpdate(C, PostUpdateMode);
+
+	TRACE_PREDICTED_SAVED_MOVE(C, PostUpdateMode == PostUpdate_Record ? EPredictedSavedMoveStep::PostUpdateRecord
+		: EPredictedSavedMoveStep::PostUpdateReplay, TimeStamp, DeltaTime);
+}
+
+void FSavedMove_Character_Modifier::PrepMoveFor(ACharacter* C)
+{
+	// Client replays this move after a correction (ClientUpdatePositionAfterServerUpdate)
+
+	Super::PrepMoveFor(C);
+
+	if (UModifierMovement* MoveComp = C ? Cast<UModifierMovement>(C->GetCharacterMovement()) : nullptr)
+	{
+		// Replay with the input this move was recorded with
+		MoveComp->GetModifierRegistry().ApplyWantsModifiers(Stacks);
+		MoveComp->SetReplayResolvePasses(ResolvePasses);
+		MoveComp->SetModifierReplayTimestamp(TimeStamp);
+	}
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::PrepMoveFor, TimeStamp, DeltaTime);
 }
 
 bool FSavedMove_Character_Modifier::IsImportantMove(const FSavedMovePtr& LastAckedMove) const
@@ -854,16 +1651,14 @@ bool FSavedMove_Character_Modifier::IsImportantMove(const FSavedMovePtr& LastAck
 	
 	const TSharedPtr<FSavedMove_Character_Modifier>& SavedMove = StaticCastSharedPtr<FSavedMove_Character_Modifier>(LastAckedMove);
 
-	if (BoostLocal.IsImportantMove(SavedMove->BoostLocal.WantsModifiers)) { return true; }
-	if (BoostCorrection.IsImportantMove(SavedMove->BoostCorrection.WantsModifiers))	{ return true; }
-	if (SlowFallLocal.IsImportantMove(SavedMove->SlowFallLocal.WantsModifiers)) { return true; }
+	if (Stacks.WantsModifiers != SavedMove->Stacks.WantsModifiers) { return true; }
 	
 	return Super::IsImportantMove(LastAckedMove);
 }
 
 FSavedMovePtr FNetworkPredictionData_Client_Character_Modifier::AllocateNewMove()
 {
-	return MakeShared<FSavedMove_Character_Modifier>();
+	return MoveSlab.Allocate(*this);
 }
 
 FNetworkPredictionData_Client* UModifierMovement::GetPredictionData_Client() const
@@ -0,0 +1,88 @@
+// Copyright (c) Jared Taylor
+
+
+#include "Modifier/ModifierMovementSubsystem.h"
+
+#include "Modifier/ModifierMovement.h"
+#include "Async/ParallelFor.h"
+#include "System/PredictedMovementTrace.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(ModifierMovementSubsystem)
+
+namespace ModifierMovementSubsystemCVars
+{
+	static bool bBatchServerMoves = false;
+	FAutoConsoleVariableRef CVarBatchServerMoves(
+		TEXT("p.Modifier.BatchServerMoves"),
+		bBatchServerMoves,
+		TEXT("If true, the server queues received moves and performs them for every character at once later in the frame.\n")
+		TEXT("Modifier levels are resolved for all characters in parallel, movement and corrections remain on the game thread"),
+		ECVF_Default);
+
+	static int32 MinParallelBatchSize = 8;
+	FAutoConsoleVariableRef CVarMinParallelBatchSize(
+		TEXT("p.Modifier.BatchServerMoves.MinParallel"),
+		MinParallelBatchSize,
+		TEXT("Below this many characters with queued moves, modifier levels are resolved on the game thread"),
+		ECVF_Default);
+}
+
+bool UModifierMovementSubsystem::IsBatchingServerMoves()
+{
+	return ModifierMovementSubsystemCVars::bBatchServerMoves;
+}
+
+void UModifierMovementSubsystem::AddPendingMovement(UModifierMovement* Movement)
+{
+	PendingMovements.Add(Movement);
+}
+
+void UModifierMovementSubsystem::PerformPendingServerMoves()
+{
+	PREDICTED_MOVEMENT_SCOPE(UModifierMovementSubsystem::PerformPendingServerMoves);
+
+	// Snapshot each character's modifier state on the game thread
+	TArray<UModifierMovement*, TInlineAllocator<128>> Movements;
+	for (const TWeakObjectPtr<UModifierMovement>& Movement : PendingMovements)
+	{
+		if (UModifierMovement* Ptr = Movement.Get())
+		{
+			Ptr->SnapshotQueuedServerMoves();
+			Movements.Add(Ptr);
+		}
+	}
+
+	// One move can queue another, e.g. if a move triggers a flush, so take ownership of the list first
+	PendingMovements.Reset();
+
+	// Resolving modifier levels only touches the snapshot, so characters are independent
+	const EParallelForFlags Flags = Movements.Num() < ModifierMovementSubsystemCVars::MinParallelBatchSize ?
+		EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+	ParallelFor(Movements.Num(), [&Movements](int32 Index)
+	{
+		Movements[Index]->PreResolveQueuedServerMoves();
+	}, Flags);
+
+	// Movement, client error checks and corrections on the game thread
+	for (UModifierMovement* Movement : Movements)
+	{
+		Movement->PerformQueuedServerMoves();
+	}
+}
+
+void UModifierMovementSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PerformPendingServerMoves();
+}
+
+TStatId UModifierMovementSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UModifierMovementSubsystem, STATGROUP_Tickables);
+}
+
+bool UModifierMovementSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Jared Taylor
+
+
+#include "Modifier/ModifierRegistry.h"
+
+int32 FModifierRegistry::AddFamily(const FGameplayTag& Type, TModSize& Level,
+	FModifierFamily::FCanActivateFunc CanActivate, std::initializer_list<FModifierSlotDesc> InSlots)
+{
+	checkf(Slots.Num() + static_cast<int32>(InSlots.size()) <= MAX_MODIFIER_SLOTS, TEXT("Too many modifier slots, the maximum is %d"), MAX_MODIFIER_SLOTS);
+	checkf(FindFamily(Type) == INDEX_NONE, TEXT("Modifier family %s is already registered"), *Type.ToString());
+
+	const int32 FamilyIndex = Families.AddDefaulted();
+	FModifierFamily& Family = Families[FamilyIndex];
+	Family.Type = Type;
+	Family.Level = &Level;
+	Family.CanActivate = CanActivate;
+	Family.FirstSlot = static_cast<uint8>(Slots.Num());
+	Family.NumSlots = static_cast<uint8>(InSlots.size());
+
+	for (const FModifierSlotDesc& Desc : InSlots)
+	{
+		const int32 SlotIndex = Slots.AddDefaulted();
+		FModifierSlot& Slot = Slots[SlotIndex];
+		Slot.Modifier = Desc.Modifier;
+		Slot.NetType = Desc.NetType;
+		Slot.Name = Desc.Name;
+		Slot.Family = static_cast<uint8>(FamilyIndex);
+
+		if (FModifierSlot::IsPredicted(Desc.NetType))
+		{
+			Slot.WantsIndex = static_cast<int8>(PredictedSlots.Add(static_cast<uint8>(SlotIndex)));
+		}
+
+		if (FModifierSlot::IsCorrected(Desc.NetType))
+		{
+			Slot.ModifiersIndex = static_cast<int8>(CorrectedSlots.Add(static_cast<uint8>(SlotIndex)));
+		}
+
+		SlotModifiers.Add(Desc.Modifier);
+	}
+
+	return FamilyIndex;
+}
+
+const FModifierSlot* FModifierRegistry::FindSlot(int32 FamilyIndex, EModifierNetType NetType) const
+{
+	if (!Families.IsValidIndex(FamilyIndex))
+	{
+		return nullptr;
+	}
+
+	const FModifierFamily& Family = Families[FamilyIndex];
+	for (int32 i = Family.FirstSlot; i < Family.FirstSlot + Family.NumSlots; ++i)
+	{
+		if (Slots[i].NetType == NetType)
+		{
+			return &Slots[i];
+		}
+	}
+	return nullptr;
+}
+
+void FModifierRegistry::GatherWantsModifiers(FModifierStacks& Stacks) const
+{
+	InitStacks(Stacks);
+	for (int32 i = 0; i < PredictedSlots.Num(); ++i)
+	{
+		Stacks.WantsModifiers[i] = Slots[PredictedSlots[i]].Modifier->WantsModifiers;
+	}
+}
+
+void FModifierRegistry::GatherModifiers(FModifierStacks& Stacks) const
+{
+	InitStacks(Stacks);
+	for (int32 i = 0; i < CorrectedSlots.Num(); ++i)
+	{
+		Stacks.Modifiers[i] = Slots[CorrectedSlots[i]].Modifier->Modifiers;
+	}
+}
+
+void FModifierRegistry::ApplyWantsModifiers(const FModifierStacks& Stacks) const
+{
+	const int32 Num = FMath::Min(PredictedSlots.Num(), Stacks.WantsModifiers.Num());
+	for (int32 i = 0; i < Num; ++i)
+	{
+		Slots[PredictedSlots[i]].Modifier->WantsModifiers = Stacks.WantsModifiers[i];
+	}
+}
@@ -6,9 +6,20 @@
 
 namespace FModifierTags
 {
-	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Modifier_Boost,		"Modifier.Boost", "Increase Movement Speed");
-	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Modifier_SlowFall,	"Modifier.SlowFall", "Reduce Gravity to a % of its normal value");
-	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Modifier_Snare,		"Modifier.Snare", "Reduced Movement Speed applied by server");
+#define PREDICTED_MODIFIER_TYPE_TAG(Name, Tag, Comment) UE_DEFINE_GAMEPLAY_TAG_COMMENT(Modifier_##Name, Tag, Comment);
+	PREDICTED_MODIFIER_TYPES(PREDICTED_MODIFIER_TYPE_TAG)
+#undef PREDICTED_MODIFIER_TYPE_TAG
 
 	UE_DEFINE_GAMEPLAY_TAG(ClientAuth_Snare,	"ClientAuth.Snare");
+
+	FGameplayTag GetModifierTypeTag(EModifierType Type)
+	{
+		switch (Type)
+		{
+#define PREDICTED_MODIFIER_TYPE_CASE(Name, Tag, Comment) case EModifierType::Name: return Modifier_##Name;
+			PREDICTED_MODIFIER_TYPES(PREDICTED_MODIFIER_TYPE_CASE)
+#undef PREDICTED_MODIFIER_TYPE_CASE
+		default: return FGameplayTag::EmptyTag;
+		}
+	}
 }
\ No newline at end of file
@@ -59,6 +59,23 @@ void AProneCharacter::SetIsProned(bool bNewProned)
 }
 
 void AProneCharacter::OnRep_IsProned()
+{
+	// Distant or unseen proxies only apply the latest state once they are significant again
+	if (DeferredProneRep.OnRep(this, bIsProned))
+	{
+		ApplyProneRep();
+	}
+}
+
+void AProneCharacter::FlushDeferredProneRep()
+{
+	if (DeferredProneRep.Flush(this, bIsProned))
+	{
+		ApplyProneRep();
+	}
+}
+
+void AProneCharacter::ApplyProneRep()
 {
 	if (ProneMovement)
 	{
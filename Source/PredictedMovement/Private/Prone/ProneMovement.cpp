@@ -5,6 +5,8 @@
 
 #include "Components/CapsuleComponent.h"
 #include "Prone/ProneCharacter.h"
+#include "System/PredictedMovementFlags.h"
+#include "System/PredictedMovementTrace.h"
 #include "Engine/World.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(ProneMovement)
@@ -142,6 +144,15 @@ void UProneMovement::SetProneLock(bool bLock)
 	}
 }
 
+FIntVector UProneMovement::GetUnProneEncroachmentCell(const FVector& Location) const
+{
+	const double CellSize = FMath::Max<double>(UnProneEncroachmentCellSize, 0.1);
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / CellSize),
+		FMath::FloorToInt32(Location.Y / CellSize),
+		FMath::FloorToInt32(Location.Z / CellSize));
+}
+
 float UProneMovement::GetTimestamp() const
 {
 	if (CharacterOwner->GetLocalRole() == ROLE_Authority)
@@ -173,6 +184,8 @@ bool UProneMovement::IsProned() const
 
 void UProneMovement::Prone(bool bClientSimulation)
 {
+	PREDICTED_MOVEMENT_SCOPE(UProneMovement::Prone);
+
 	if (!HasValidData())
 	{
 		return;
@@ -193,6 +206,7 @@ void UProneMovement::Prone(bool bClientSimulation)
 		}
 		ProneCharacterOwner->OnStartProne( 0.f, 0.f );
 		SetProneLock(true);
+		TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::Prone, EPredictedProneResult::Succeeded, 0);
 		return;
 	}
 
@@ -214,6 +228,7 @@ void UProneMovement::Prone(bool bClientSimulation)
 	CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(PronedRadius, ClampedPronedHalfHeight);
 	float HalfHeightAdjust = (OldUnscaledHalfHeight - ClampedPronedHalfHeight);
 	float ScaledHalfHeightAdjust = HalfHeightAdjust * ComponentScale;
+	[[maybe_unused]] int32 NumQueries = 0;
 
 	if( !bClientSimulation )
 	{
@@ -223,6 +238,7 @@ void UProneMovement::Prone(bool bClientSimulation)
 			FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(ProneTrace), false, CharacterOwner);
 			FCollisionResponseParams ResponseParam;
 			InitCollisionParams(CapsuleParams, ResponseParam);
+			++NumQueries;
 			const bool bEncroached = GetWorld()->OverlapBlockingTestByChannel(UpdatedComponent->GetComponentLocation() - FVector(0.f,0.f,ScaledHalfHeightAdjust), FQuat::Identity,
 				UpdatedComponent->GetCollisionObjectType(), GetPawnCapsuleCollisionShape(SHRINK_None), CapsuleParams, ResponseParam);
 
@@ -230,6 +246,7 @@ void UProneMovement::Prone(bool bClientSimulation)
 			if( bEncroached )
 			{
 				CharacterOwner->GetCapsuleComponent()->SetCapsuleSize(OldUnscaledRadius, OldUnscaledHalfHeight);
+				TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::Prone, EPredictedProneResult::Encroached, NumQueries);
 				return;
 			}
 		}
@@ -250,6 +267,7 @@ void UProneMovement::Prone(bool bClientSimulation)
 	FHitResult Hit;
 	const FVector Start = UpdatedComponent->GetComponentLocation() - FVector(0.f,0.f,ScaledHalfHeightAdjust);
 	const FVector End = UpdatedComponent->GetComponentLocation() - FVector(0.f,0.f,ScaledHalfHeightAdjust * 1.01f);
+	++NumQueries;
 	if (GetWorld()->SweepSingleByChannel(Hit, Start, End, FQuat::Identity, UpdatedComponent->GetCollisionObjectType(), FCollisionShape::MakeCapsule(PronedRadius, PronedHalfHeight), CapsuleParams, ResponseParam))
 	{
 		if (Hit.bStartPenetrating)
@@ -287,10 +305,14 @@ void UProneMovement::Prone(bool bClientSimulation)
 			ClientData->OriginalMeshTranslationOffset = ClientData->MeshTranslationOffset;
 		}
 	}
+
+	TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::Prone, EPredictedProneResult::Succeeded, NumQueries);
 }
 
 void UProneMovement::UnProne(bool bClientSimulation)
 {
+	PREDICTED_MOVEMENT_SCOPE(UProneMovement::UnProne);
+
 	if (!HasValidData())
 	{
 		return;
@@ -298,6 +320,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 
 	if (IsProneLocked())
 	{
+		TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::UnProne, EPredictedProneResult::Locked, 0);
 		return;
 	}
 
@@ -312,6 +335,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 			ProneCharacterOwner->SetIsProned(false);
 		}
 		ProneCharacterOwner->OnEndProne( 0.f, 0.f );
+		TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::UnProne, EPredictedProneResult::Succeeded, 0);
 		return;
 	}
 
@@ -322,12 +346,26 @@ void UProneMovement::UnProne(bool bClientSimulation)
 	const float HalfHeightAdjust = DefaultCharacter->GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight() - OldUnscaledHalfHeight;
 	const float ScaledHalfHeightAdjust = HalfHeightAdjust * ComponentScale;
 	const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
+	[[maybe_unused]] int32 NumQueries = 0;
 
 	// Grow to unproned size.
 	check(CharacterOwner->GetCapsuleComponent());
 
 	if( !bClientSimulation )
 	{
+		// Skip the encroachment tests if they already failed here, nothing they depend on has changed
+		// Dynamic bases can move the geometry without the character moving, so they aren't cached
+		UPrimitiveComponent* MovementBase = CharacterOwner->GetMovementBase();
+		const bool bCanCacheEncroachment = bCacheUnProneEncroachment && !MovementBaseUtility::IsDynamicBase(MovementBase);
+		const FIntVector EncroachmentCell = bCanCacheEncroachment ? GetUnProneEncroachmentCell(PawnLocation) : FIntVector::ZeroValue;
+		const float UnscaledRadius = CharacterOwner->GetCapsuleComponent()->GetUnscaledCapsuleRadius();
+		if (bCanCacheEncroachment && UnProneEncroachmentCache.Matches(MovementBase, EncroachmentCell, UnscaledRadius,
+			OldUnscaledHalfHeight, ScaledHalfHeightAdjust, GetTimestamp()))
+		{
+			TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::UnProne, EPredictedProneResult::CachedEncroached, 0);
+			return;
+		}
+
 		// Try to stay in place and see if the larger capsule fits. We use a slightly taller capsule to avoid penetration.
 		const UWorld* MyWorld = GetWorld();
 		constexpr float SweepInflation = UE_KINDA_SMALL_NUMBER * 10.f;
@@ -343,6 +381,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 		if (!bCrouchMaintainsBaseLocation)
 		{
 			// Expand in place
+			++NumQueries;
 			bEncroached = MyWorld->OverlapBlockingTestByChannel(PawnLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 		
 			if (bEncroached)
@@ -359,6 +398,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 
 					FHitResult Hit(1.f);
 					const FCollisionShape ShortCapsuleShape = GetPawnCapsuleCollisionShape(SHRINK_HeightCustom, ShrinkHalfHeight);
+					++NumQueries;
 					MyWorld->SweepSingleByChannel(Hit, PawnLocation, PawnLocation + Down, FQuat::Identity, CollisionChannel, ShortCapsuleShape, CapsuleParams);
 					if (Hit.bStartPenetrating)
 					{
@@ -369,6 +409,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 						// Compute where the base of the sweep ended up, and see if we can stand there
 						const float DistanceToBase = (Hit.Time * TraceDist) + ShortCapsuleShape.Capsule.HalfHeight;
 						const FVector NewLoc = FVector(PawnLocation.X, PawnLocation.Y, PawnLocation.Z - DistanceToBase + StandingCapsuleShape.Capsule.HalfHeight + SweepInflation + MIN_FLOOR_DIST / 2.f);
+						++NumQueries;
 						bEncroached = MyWorld->OverlapBlockingTestByChannel(NewLoc, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 						if (!bEncroached)
 						{
@@ -383,6 +424,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 		{
 			// Expand while keeping base location the same.
 			FVector StandingLocation = PawnLocation + FVector(0.f, 0.f, StandingCapsuleShape.GetCapsuleHalfHeight() - CurrentPronedHalfHeight);
+			++NumQueries;
 			bEncroached = MyWorld->OverlapBlockingTestByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 
 			if (bEncroached)
@@ -394,6 +436,7 @@ void UProneMovement::UnProne(bool bClientSimulation)
 					if (CurrentFloor.bBlockingHit && CurrentFloor.FloorDist > MinFloorDist)
 					{
 						StandingLocation.Z -= CurrentFloor.FloorDist - MinFloorDist;
+						++NumQueries;
 						bEncroached = MyWorld->OverlapBlockingTestByChannel(StandingLocation, FQuat::Identity, CollisionChannel, StandingCapsuleShape, CapsuleParams, ResponseParam);
 					}
 				}				
@@ -410,9 +453,22 @@ void UProneMovement::UnProne(bool bClientSimulation)
 		// If still encroached then abort.
 		if (bEncroached)
 		{
+			if (bCanCacheEncroachment)
+			{
+				UnProneEncroachmentCache.Base = MovementBase;
+				UnProneEncroachmentCache.Cell = EncroachmentCell;
+				UnProneEncroachmentCache.Radius = UnscaledRadius;
+				UnProneEncroachmentCache.HalfHeight = OldUnscaledHalfHeight;
+				UnProneEncroachmentCache.ScaledHalfHeightAdjust = ScaledHalfHeightAdjust;
+				UnProneEncroachmentCache.Timestamp = GetTimestamp();
+				UnProneEncroachmentCache.ExpiryTimestamp = UnProneEncroachmentCache.Timestamp + UnProneEncroachmentCacheDuration;
+				UnProneEncroachmentCache.bValid = true;
+			}
+			TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::UnProne, EPredictedProneResult::Encroached, NumQueries);
 			return;
 		}
 
+		UnProneEncroachmentCache.Invalidate();
 		ProneCharacterOwner->SetIsProned(false);
 	}	
 	else
@@ -437,6 +493,8 @@ void UProneMovement::UnProne(bool bClientSimulation)
 			ClientData->OriginalMeshTranslationOffset = ClientData->MeshTranslationOffset;
 		}
 	}
+
+	TRACE_PREDICTED_PRONE_ATTEMPT(CharacterOwner, EPredictedProneAttempt::UnProne, EPredictedProneResult::Succeeded, NumQueries);
 }
 
 bool UProneMovement::CanProneInCurrentState() const
@@ -512,6 +570,16 @@ void UProneMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
 	}
 }
 
+void UProneMovement::SimulatedTick(float DeltaSeconds)
+{
+	if (ProneCharacterOwner && ProneCharacterOwner->HasDeferredProneRep())
+	{
+		ProneCharacterOwner->FlushDeferredProneRep();
+	}
+
+	Super::SimulatedTick(DeltaSeconds);
+}
+
 bool UProneMovement::ClientUpdatePositionAfterServerUpdate()
 {
 	const bool bRealProne = bWantsToProne;
@@ -536,6 +604,8 @@ void FSavedMove_Character_Prone::SetMoveFor(ACharacter* C, float InDeltaTime, FV
 
 	bWantsToProne = Cast<AProneCharacter>(C)->GetProneCharacterMovement()->bWantsToProne;
 	bProneLocked = Cast<AProneCharacter>(C)->GetProneCharacterMovement()->bProneLocked;
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::SetMoveFor, TimeStamp, DeltaTime);
 }
 
 void FSavedMove_Character_Prone::PrepMoveFor(ACharacter* C)
@@ -543,16 +613,15 @@ void FSavedMove_Character_Prone::PrepMoveFor(ACharacter* C)
 	Super::PrepMoveFor(C);
 
 	Cast<AProneCharacter>(C)->GetProneCharacterMovement()->bProneLocked = bProneLocked;
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::PrepMoveFor, TimeStamp, DeltaTime);
 }
 
 uint8 FSavedMove_Character_Prone::GetCompressedFlags() const
 {
 	uint8 Result = Super::GetCompressedFlags();
 
-	if (bWantsToProne)
-	{
-		Result |= FLAG_Custom_1;
-	}
+	PredictedMovementFlags::Pack(Result, bWantsToProne, PredictedMovementFlags::Prone);
 
 	return Result;
 }
@@ -561,12 +630,12 @@ void UProneMovement::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
-	bWantsToProne = ((Flags & FSavedMove_Character::FLAG_Custom_1) != 0);
+	bWantsToProne = PredictedMovementFlags::Unpack(Flags, PredictedMovementFlags::Prone);
 }
 
 FSavedMovePtr FNetworkPredictionData_Client_Character_Prone::AllocateNewMove()
 {
-	return MakeShared<FSavedMove_Character_Prone>();
+	return MoveSlab.Allocate(*this);
 }
 
 FNetworkPredictionData_Client* UProneMovement::GetPredictionData_Client() const
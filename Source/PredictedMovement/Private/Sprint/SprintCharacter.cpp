@@ -59,6 +59,23 @@ bool ASprintCharacter::IsSprintingInEffect() const
 }
 
 void ASprintCharacter::OnRep_IsSprinting()
+{
+	// Distant or unseen proxies only apply the latest state once they are significant again
+	if (DeferredSprintRep.OnRep(this, bIsSprinting))
+	{
+		ApplySprintRep();
+	}
+}
+
+void ASprintCharacter::FlushDeferredSprintRep()
+{
+	if (DeferredSprintRep.Flush(this, bIsSprinting))
+	{
+		ApplySprintRep();
+	}
+}
+
+void ASprintCharacter::ApplySprintRep()
 {
 	if (SprintMovement)
 	{
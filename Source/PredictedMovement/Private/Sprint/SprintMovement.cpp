@@ -4,6 +4,8 @@
 #include "Sprint/SprintMovement.h"
 
 #include "Sprint/SprintCharacter.h"
+#include "System/PredictedMovementFlags.h"
+#include "System/PredictedMovementTrace.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SprintMovement)
 
@@ -66,8 +68,22 @@ void USprintMovement::SetUpdatedComponent(USceneComponent* NewUpdatedComponent)
 	SprintCharacterOwner = Cast<ASprintCharacter>(PawnOwner);
 }
 
+USprintMovement::FSprintEvaluation USprintMovement::EvaluateSprint() const
+{
+	FSprintEvaluation Eval;
+	Eval.bSprinting = IsSprinting();
+	Eval.bAtSpeed = Eval.bSprinting && IsSprintingAtSpeed();
+	Eval.bWithinInputAngle = IsSprintWithinAllowableInputAngle();
+	return Eval;
+}
+
 bool USprintMovement::IsSprintingAtSpeed() const
 {
+	if (SprintEval.bValid)
+	{
+		return SprintEval.bAtSpeed;
+	}
+
 	if (!IsSprinting())
 	{
 		return false;
@@ -112,11 +128,20 @@ float USprintMovement::GetMaxBrakingDeceleration() const
 
 void USprintMovement::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
 {
-	if (IsSprinting() && IsMovingOnGround())
+	PREDICTED_MOVEMENT_SCOPE(USprintMovement::CalcVelocity);
+
+	// GetMaxSpeed(), GetMaxAcceleration() and ApplyVelocityBraking() are called by the base CalcVelocity
+	// Evaluate the sprint state once for all of them instead of on every call
+	SprintEval = EvaluateSprint();
+	SprintEval.bValid = true;
+
+	if (SprintEval.bSprinting && IsMovingOnGround())
 	{
 		Friction = GroundFrictionSprinting;
 	}
 	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+
+	SprintEval.bValid = false;
 }
 
 void USprintMovement::ApplyVelocityBraking(float DeltaTime, float Friction, float BrakingDeceleration)
@@ -136,6 +161,10 @@ void USprintMovement::SetMaxInputAngleSprint(float InMaxAngleSprint)
 
 bool USprintMovement::IsSprinting() const
 {
+	if (SprintEval.bValid)
+	{
+		return SprintEval.bSprinting;
+	}
 	return SprintCharacterOwner && SprintCharacterOwner->IsSprinting();
 }
 
@@ -189,6 +218,11 @@ bool USprintMovement::CanSprintInCurrentState() const
 
 bool USprintMovement::IsSprintWithinAllowableInputAngle() const
 {
+	if (SprintEval.bValid)
+	{
+		return SprintEval.bWithinInputAngle;
+	}
+
 	if (!bRestrictSprintInputAngle && MaxInputAngleSprint <= 0.f)
 	{
 		return true;
@@ -203,6 +237,8 @@ bool USprintMovement::IsSprintWithinAllowableInputAngle() const
 
 void USprintMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 {
+	PREDICTED_MOVEMENT_SCOPE(USprintMovement::UpdateCharacterStateBeforeMovement);
+
 	// Proxies get replicated Sprint state.
 	if (CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
 	{
@@ -236,6 +272,16 @@ void USprintMovement::UpdateCharacterStateAfterMovement(float DeltaSeconds)
 	Super::UpdateCharacterStateAfterMovement(DeltaSeconds);
 }
 
+void USprintMovement::SimulatedTick(float DeltaSeconds)
+{
+	if (SprintCharacterOwner && SprintCharacterOwner->HasDeferredSprintRep())
+	{
+		SprintCharacterOwner->FlushDeferredSprintRep();
+	}
+
+	Super::SimulatedTick(DeltaSeconds);
+}
+
 bool USprintMovement::ClientUpdatePositionAfterServerUpdate()
 {
 	const bool bRealSprint = bWantsToSprint;
@@ -249,17 +295,14 @@ void USprintMovement::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
-	bWantsToSprint = ((Flags & FSavedMove_Character::FLAG_Custom_0) != 0);
+	bWantsToSprint = PredictedMovementFlags::Unpack(Flags, PredictedMovementFlags::Sprint);
 }
 
 uint8 FSavedMove_Character_Sprint::GetCompressedFlags() const
 {
 	uint8 Result = Super::GetCompressedFlags();
 
-	if (bWantsToSprint)
-	{
-		Result |= FLAG_Custom_0;
-	}
+	PredictedMovementFlags::Pack(Result, bWantsToSprint, PredictedMovementFlags::Sprint);
 
 	return Result;
 }
@@ -277,11 +320,13 @@ void FSavedMove_Character_Sprint::SetMoveFor(ACharacter* C, float InDeltaTime, F
 	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
 
 	bWantsToSprint = Cast<ASprintCharacter>(C)->GetSprintCharacterMovement()->bWantsToSprint;
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::SetMoveFor, TimeStamp, DeltaTime);
 }
 
 FSavedMovePtr FNetworkPredictionData_Client_Character_Sprint::AllocateNewMove()
 {
-	return MakeShared<FSavedMove_Character_Sprint>();
+	return MoveSlab.Allocate(*this);
 }
 
 FNetworkPredictionData_Client* USprintMovement::GetPredictionData_Client() const
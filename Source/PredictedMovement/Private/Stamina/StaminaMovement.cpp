@@ -4,9 +4,76 @@
 #include "Stamina/StaminaMovement.h"
 
 #include "GameFramework/Character.h"
+#include "System/PredictedMovementStats.h"
+#include "System/PredictedMovementTrace.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(StaminaMovement)
 
+float FStaminaRateModel::Advance(float Stamina, bool& bDrained, bool bConsuming, float MaxStamina, float DeltaTime) const
+{
+	const float DrainedStamina = DrainedThreshold * MaxStamina;
+	const float RecoveredStamina = RecoveredThreshold * MaxStamina;
+
+	// Each segment is linear, so only the time until the next threshold is needed
+	float RemainingTime = DeltaTime;
+	while (RemainingTime > 0.f)
+	{
+		if (!bDrained && bConsuming && DrainRate > 0.f)
+		{
+			const float TimeToDrain = FMath::Max(0.f, Stamina - DrainedStamina) / DrainRate;
+			if (TimeToDrain > RemainingTime)
+			{
+				return Stamina - DrainRate * RemainingTime;
+			}
+			Stamina = FMath::Min(Stamina, DrainedStamina);
+			RemainingTime -= TimeToDrain;
+			bDrained = true;
+			bConsuming = false;
+		}
+		else if (bDrained)
+		{
+			if (RegenRate <= 0.f)
+			{
+				return Stamina;
+			}
+			const float TimeToRecover = FMath::Max(0.f, RecoveredStamina - Stamina) / RegenRate;
+			if (TimeToRecover > RemainingTime)
+			{
+				return Stamina + RegenRate * RemainingTime;
+			}
+			Stamina = FMath::Max(Stamina, RecoveredStamina);
+			RemainingTime -= TimeToRecover;
+			bDrained = false;
+		}
+		else
+		{
+			if (bConsuming || RegenRate <= 0.f)
+			{
+				return Stamina;
+			}
+			return FMath::Min(MaxStamina, Stamina + RegenRate * RemainingTime);
+		}
+	}
+	return Stamina;
+}
+
+EStaminaSegment FStaminaRateModel::GetSegment(float Stamina, bool bDrained, bool bConsuming, float MaxStamina) const
+{
+	if (bDrained)
+	{
+		return EStaminaSegment::Drained;
+	}
+	if (bConsuming && DrainRate > 0.f)
+	{
+		return EStaminaSegment::Draining;
+	}
+	if (!bConsuming && Stamina < MaxStamina && RegenRate > 0.f)
+	{
+		return EStaminaSegment::Regenerating;
+	}
+	return EStaminaSegment::Idle;
+}
+
 void FStaminaMoveResponseDataContainer::ServerFillResponseData(
 	const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
 {
@@ -27,10 +94,22 @@ bool FStaminaMoveResponseDataContainer::Serialize(UCharacterMovementComponent& C
 	}
 
 	// Server ➜ Client
+	FPredictedMovementScopedNetBits ScopedNetBits(Ar, EPredictedNetFeature::StaminaMoveResponse);
 	if (IsCorrection())
 	{
-		Ar << Stamina;
-		Ar << bStaminaDrained;
+		const UStaminaMovement* MoveComp = Cast<UStaminaMovement>(&CharacterMovement);
+		if (MoveComp)
+		{
+			MoveComp->NetSerializeStamina(Ar, Stamina);
+		}
+		else
+		{
+			Ar << Stamina;
+		}
+
+		uint8 bDrained = Ar.IsLoading() ? 0 : bStaminaDrained;
+		Ar.SerializeBits(&bDrained, 1);
+		bStaminaDrained = bDrained != 0;
 	}
 
 	return !Ar.IsError();
@@ -41,7 +120,10 @@ void FStaminaNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Charact
     Super::ClientFillNetworkMoveData(ClientMove, MoveType);
 	
 	// Client ➜ Server
-    Stamina = static_cast<const FSavedMove_Character_Stamina&>(ClientMove).EndStamina;
+	const FSavedMove_Character_Stamina& SavedMove = static_cast<const FSavedMove_Character_Stamina&>(ClientMove);
+    Stamina = SavedMove.EndStamina;
+	StaminaSegment = SavedMove.EndStaminaSegment;
+	bHasStamina = SavedMove.bSendStamina;
 }
 
 bool FStaminaNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
@@ -49,7 +131,33 @@ bool FStaminaNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMo
     Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
 
 	// Client ➜ Server
-    SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Stamina, 0.f);
+	FPredictedMovementScopedNetBits ScopedNetBits(Ar, EPredictedNetFeature::StaminaMoveData);
+	const UStaminaMovement* MoveComp = Cast<UStaminaMovement>(&CharacterMovement);
+	if (MoveComp && MoveComp->bUseStaminaRateModel)
+	{
+		// The server reconstructs stamina from the segment, unless the client had to send it
+		uint8 Segment = Ar.IsLoading() ? 0 : static_cast<uint8>(StaminaSegment);
+		Ar.SerializeBits(&Segment, 2);
+		StaminaSegment = static_cast<EStaminaSegment>(Segment);
+
+		uint8 bSerializeStamina = Ar.IsLoading() ? 0 : bHasStamina;
+		Ar.SerializeBits(&bSerializeStamina, 1);
+		bHasStamina = bSerializeStamina != 0;
+		if (bHasStamina)
+		{
+			MoveComp->NetSerializeStamina(Ar, Stamina);
+		}
+	}
+	else if (MoveComp && MoveComp->NetworkStaminaQuantizationStep > 0.f)
+	{
+		bHasStamina = true;
+		MoveComp->NetSerializeStamina(Ar, Stamina);
+	}
+	else
+	{
+		bHasStamina = true;
+		SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Stamina, 0.f);
+	}
     return !Ar.IsError();
 }
 
@@ -60,6 +168,8 @@ UStaminaMovement::UStaminaMovement(const FObjectInitializer& ObjectInitializer)
     SetNetworkMoveDataContainer(StaminaMoveDataContainer);
 
 	NetworkStaminaCorrectionThreshold = 2.f;
+	NetworkStaminaQuantizationStep = 0.025f;
+	bUseStaminaRateModel = false;
 }
 
 void UStaminaMovement::SetStamina(float NewStamina)
@@ -70,6 +180,7 @@ void UStaminaMovement::SetStamina(float NewStamina)
 	{
 		if (!FMath::IsNearlyEqual(PrevStamina, Stamina))
 		{
+			MarkStaminaChangedOutsideModel();
 			OnStaminaChanged(PrevStamina, Stamina);
 		}
 	}
@@ -96,6 +207,7 @@ void UStaminaMovement::SetStaminaDrained(bool bNewValue)
 	{
 		if (bWasStaminaDrained != bStaminaDrained)
 		{
+			MarkStaminaChangedOutsideModel();
 			if (bStaminaDrained)
 			{
 				OnStaminaDrained();
@@ -108,8 +220,77 @@ void UStaminaMovement::SetStaminaDrained(bool bNewValue)
 	}
 }
 
+void UStaminaMovement::MarkStaminaChangedOutsideModel()
+{
+	// Only the server needs to know, the client's own changes are either predicted or corrected
+	if (bUseStaminaRateModel && !bAdvancingStamina && CharacterOwner->HasAuthority() &&
+		CharacterOwner->GetRemoteRole() == ROLE_AutonomousProxy)
+	{
+		bStaminaChangedOutsideModel = true;
+	}
+}
+
+void UStaminaMovement::NetSerializeStamina(FArchive& Ar, float& Value) const
+{
+	if (NetworkStaminaQuantizationStep <= 0.f)
+	{
+		Ar << Value;
+		return;
+	}
+
+	// An absolute step, so both ends decode the same value regardless of MaxStamina, and values above it survive
+	uint32 Quantized = 0;
+	if (Ar.IsSaving())
+	{
+		Quantized = static_cast<uint32>(FMath::Max(0, FMath::RoundToInt(Value / NetworkStaminaQuantizationStep)));
+	}
+
+	Ar.SerializeIntPacked(Quantized);
+
+	if (Ar.IsLoading())
+	{
+		Value = Quantized * NetworkStaminaQuantizationStep;
+	}
+}
+
+void UStaminaMovement::CalcStamina(float DeltaTime)
+{
+	PREDICTED_MOVEMENT_SCOPE(UStaminaMovement::CalcStamina);
+
+	TGuardValue<bool> AdvancingStaminaGuard(bAdvancingStamina, true);
+
+	bool bDrained = bStaminaDrained;
+	const float NewStamina = StaminaRateModel.Advance(Stamina, bDrained, ShouldDrainStamina(), MaxStamina, DeltaTime);
+	SetStamina(NewStamina);
+	SetStaminaDrained(bDrained);
+}
+
+void UStaminaMovement::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	if (bUseStaminaRateModel)
+	{
+		CalcStamina(DeltaTime);
+	}
+
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+}
+
 void UStaminaMovement::OnStaminaChanged(float PrevValue, float NewValue)
 {
+	if (bUseStaminaRateModel)
+	{
+		// Drain state follows the model's thresholds, in case stamina is set directly, e.g. by GAS
+		if (!bStaminaDrained && Stamina <= StaminaRateModel.DrainedThreshold * MaxStamina)
+		{
+			SetStaminaDrained(true);
+		}
+		else if (bStaminaDrained && Stamina >= StaminaRateModel.RecoveredThreshold * MaxStamina)
+		{
+			SetStaminaDrained(false);
+		}
+		return;
+	}
+
 	if (FMath::IsNearlyZero(Stamina))
 	{
 		Stamina = 0.f;
@@ -147,9 +328,18 @@ bool FSavedMove_Character_Stamina::CanCombineWith(const FSavedMovePtr& NewMove,
 {
 	const TSharedPtr<FSavedMove_Character_Stamina>& SavedMove = StaticCastSharedPtr<FSavedMove_Character_Stamina>(NewMove);
 
-	if (bStaminaDrained != SavedMove->bStaminaDrained)
+	const UStaminaMovement* MoveComp = InCharacter ? Cast<UStaminaMovement>(InCharacter->GetCharacterMovement()) : nullptr;
+	if (MoveComp && MoveComp->bUseStaminaRateModel)
 	{
-		return false;
+		// The rate model is exact over the combined DeltaTime as long as the input to it is unchanged
+		if (bConsumingStamina != SavedMove->bConsumingStamina)
+		{
+			return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedStaminaConsuming, TimeStamp);
+		}
+	}
+	else if (bStaminaDrained != SavedMove->bStaminaDrained)
+	{
+		return ReportPredictedCombine(InCharacter, EPredictedCombineResult::RejectedStaminaDrained, TimeStamp);
 	}
 
 	// if (bStartStaminaDrained != SavedMove->bStartStaminaDrained || bStartStaminaDrained != SavedMove->bSavedStaminaDrained)
@@ -157,7 +347,8 @@ bool FSavedMove_Character_Stamina::CanCombineWith(const FSavedMovePtr& NewMove,
 	// 	return false;
 	// }
 
-	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	const bool bCanCombine = Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	return ReportPredictedCombine(InCharacter, bCanCombine ? EPredictedCombineResult::Combined : EPredictedCombineResult::RejectedBase, TimeStamp);
 }
 
 void FSavedMove_Character_Stamina::CombineWith(const FSavedMove_Character* OldMove, ACharacter* C,
@@ -172,6 +363,8 @@ void FSavedMove_Character_Stamina::CombineWith(const FSavedMove_Character* OldMo
 		MoveComp->SetStamina(SavedOldMove->StartStamina);
 		MoveComp->SetStaminaDrained(SavedOldMove->bStaminaDrained);
 	}
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::CombineWith, TimeStamp, DeltaTime);
 }
 
 void FSavedMove_Character_Stamina::Clear()
@@ -179,6 +372,9 @@ void FSavedMove_Character_Stamina::Clear()
 	Super::Clear();
 
 	bStaminaDrained = false;
+	bConsumingStamina = false;
+	bSendStamina = true;
+	EndStaminaSegment = EStaminaSegment::Idle;
 	StartStamina = 0.f;
 	EndStamina = 0.f;
 }
@@ -190,6 +386,7 @@ void FSavedMove_Character_Stamina::SetInitialPosition(ACharacter* C)
 	if (const UStaminaMovement* MoveComp = C ? Cast<UStaminaMovement>(C->GetCharacterMovement()) : nullptr)
 	{
 		bStaminaDrained = MoveComp->IsStaminaDrained();
+		bConsumingStamina = MoveComp->ShouldDrainStamina();
 		StartStamina = MoveComp->GetStamina();
 	}
 }
@@ -200,18 +397,36 @@ void FSavedMove_Character_Stamina::PostUpdate(ACharacter* C, EPostUpdateMode Pos
 	if (UStaminaMovement* MoveComp = C ? Cast<UStaminaMovement>(C->GetCharacterMovement()) : nullptr)
 	{
 		EndStamina = MoveComp->GetStamina();
-	
-		if (PostUpdateMode == PostUpdate_Record)
+		EndStaminaSegment = MoveComp->GetStaminaSegment();
+
+		if (MoveComp->bUseStaminaRateModel)
 		{
-			// Don't combine moves if the modifiers changed over the course of the move
-			if (bStaminaDrained != MoveComp->IsStaminaDrained())
+			// Send the stamina if the segment changed, or something other than the model changed it, e.g. GAS
+			const FStaminaRateModel& Model = MoveComp->StaminaRateModel;
+			bool bExpectedDrained = bStaminaDrained;
+			const float ExpectedStamina = Model.Advance(StartStamina, bExpectedDrained, bConsumingStamina, MoveComp->GetMaxStamina(), DeltaTime);
+			const EStaminaSegment StartSegment = Model.GetSegment(StartStamina, bStaminaDrained, bConsumingStamina, MoveComp->GetMaxStamina());
+			bSendStamina = StartSegment != EndStaminaSegment || bExpectedDrained != MoveComp->IsStaminaDrained() ||
+				!FMath::IsNearlyEqual(ExpectedStamina, EndStamina, KINDA_SMALL_NUMBER);
+		}
+		else
+		{
+			bSendStamina = true;
+			if (PostUpdateMode == PostUpdate_Record)
 			{
-				bForceNoCombine = true;
+				// Don't combine moves if the modifiers changed over the course of the move
+				if (bStaminaDrained != MoveComp->IsStaminaDrained())
+				{
+					bForceNoCombine = true;
+				}
 			}
 		}
 	}
 
 	Super::PostUpdate(C, PostUpdateMode);
+
+	TRACE_PREDICTED_SAVED_MOVE(C, PostUpdateMode == PostUpdate_Record ? EPredictedSavedMoveStep::PostUpdateRecord
+		: EPredictedSavedMoveStep::PostUpdateReplay, TimeStamp, DeltaTime);
 }
 
 void UStaminaMovement::OnClientCorrectionReceived(class FNetworkPredictionData_Client_Character& ClientData,
@@ -241,23 +456,62 @@ bool UStaminaMovement::ServerCheckClientError(float ClientTimeStamp, float Delta
 {
 	// ServerMovePacked_ServerReceive ➜ ServerMove_HandleMoveData ➜ ServerMove_PerformMovement
 	// ➜ ServerMoveHandleClientError ➜ ServerCheckClientError
+
+	// Any correction sent from here carries the server's stamina, so an external change only needs flagging once
+	const bool bForceStaminaCorrection = bStaminaChangedOutsideModel;
+	bStaminaChangedOutsideModel = false;
 	
     if (Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode))
     {
+		PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::Movement);
+		TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::Movement, nullptr, ClientTimeStamp);
         return true;
     }
     
 	// This will trigger a client correction if the Stamina value in the Client differs NetworkStaminaCorrectionThreshold (2.f default) units from the one in the server
 	// Desyncs can happen if we set the Stamina directly in Gameplay code (ie: GAS)
     const FStaminaNetworkMoveData* CurrentMoveData = static_cast<const FStaminaNetworkMoveData*>(GetCurrentNetworkMoveData());
-    if (!FMath::IsNearlyEqual(CurrentMoveData->Stamina, Stamina, NetworkStaminaCorrectionThreshold))
+	if (bUseStaminaRateModel && CurrentMoveData->StaminaSegment != GetStaminaSegment())
+	{
+		PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::StaminaSegment);
+		TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::StaminaSegment, nullptr, ClientTimeStamp);
+		return true;
+	}
+
+    if (CurrentMoveData->bHasStamina && !FMath::IsNearlyEqual(CurrentMoveData->Stamina, Stamina, NetworkStaminaCorrectionThreshold))
     {
+		PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::Stamina);
+		TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::Stamina, nullptr, ClientTimeStamp);
         return true;
     }
+
+	// The client only sent its segment, which can match even though the server changed stamina, e.g. a potion
+	// while both are regenerating, the model can't have produced this change so the client can't have predicted it
+	if (bForceStaminaCorrection && !CurrentMoveData->bHasStamina)
+	{
+		PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause::Stamina);
+		TRACE_PREDICTED_CORRECTION(CharacterOwner, EPredictedCorrectionCause::Stamina, nullptr, ClientTimeStamp);
+		return true;
+	}
     
     return false;
 }
 
+void UStaminaMovement::CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove,
+	const FSavedMove_Character* OldMove)
+{
+	// The move data container is serialized with the engine's FNetBitWriter
+	const FPredictedMovementScopedNetWriter ScopedNetWriter;
+	Super::CallServerMovePacked(NewMove, PendingMove, OldMove);
+}
+
+void UStaminaMovement::ServerSendMoveResponse(const FClientAdjustment& PendingAdjustment)
+{
+	// The move response container is serialized with the engine's FNetBitWriter
+	const FPredictedMovementScopedNetWriter ScopedNetWriter;
+	Super::ServerSendMoveResponse(PendingAdjustment);
+}
+
 FNetworkPredictionData_Client* UStaminaMovement::GetPredictionData_Client() const
 {
 	if (ClientPredictionData == nullptr)
@@ -271,5 +525,5 @@ FNetworkPredictionData_Client* UStaminaMovement::GetPredictionData_Client() cons
 
 FSavedMovePtr FNetworkPredictionData_Client_Character_Stamina::AllocateNewMove()
 {
-	return MakeShared<FSavedMove_Character_Stamina>();
+	return MoveSlab.Allocate(*this);
 }
\ No newline at end of file
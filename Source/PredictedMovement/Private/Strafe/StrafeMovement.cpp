@@ -4,6 +4,8 @@
 #include "Strafe/StrafeMovement.h"
 
 #include "Strafe/StrafeCharacter.h"
+#include "System/PredictedMovementFlags.h"
+#include "System/PredictedMovementTrace.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(StrafeMovement)
 
@@ -128,6 +130,8 @@ bool UStrafeMovement::CanStrafeInCurrentState() const
 
 void UStrafeMovement::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
 {
+	PREDICTED_MOVEMENT_SCOPE(UStrafeMovement::UpdateCharacterStateBeforeMovement);
+
 	// Proxies get replicated Strafe state.
 	if (CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
 	{
@@ -183,16 +187,15 @@ void FSavedMove_Character_Strafe::SetMoveFor(ACharacter* C, float InDeltaTime, F
 	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
 
 	bWantsToStrafe = Cast<AStrafeCharacter>(C)->GetStrafeCharacterMovement()->bWantsToStrafe;
+
+	TRACE_PREDICTED_SAVED_MOVE(C, EPredictedSavedMoveStep::SetMoveFor, TimeStamp, DeltaTime);
 }
 
 uint8 FSavedMove_Character_Strafe::GetCompressedFlags() const
 {
 	uint8 Result = Super::GetCompressedFlags();
 
-	if (bWantsToStrafe)
-	{
-		Result |= FLAG_Reserved_1;
-	}
+	PredictedMovementFlags::Pack(Result, bWantsToStrafe, PredictedMovementFlags::Strafe);
 
 	return Result;
 }
@@ -201,12 +204,12 @@ void UStrafeMovement::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
-	bWantsToStrafe = ((Flags & FSavedMove_Character::FLAG_Reserved_1) != 0);
+	bWantsToStrafe = PredictedMovementFlags::Unpack(Flags, PredictedMovementFlags::Strafe);
 }
 
 FSavedMovePtr FNetworkPredictionData_Client_Character_Strafe::AllocateNewMove()
 {
-	return MakeShared<FSavedMove_Character_Strafe>();
+	return MoveSlab.Allocate(*this);
 }
 
 FNetworkPredictionData_Client* UStrafeMovement::GetPredictionData_Client() const
@@ -0,0 +1,358 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "Modifier/ModifierCharacter.h"
+#include "Modifier/ModifierMovement.h"
+#include "Stamina/StaminaMovement.h"
+#include "System/PredictedMovementScopedWorld.h"
+#include "System/PredictedMovementStats.h"
+#include "System/PredictedSimulatedState.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/CoreNet.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Micro-benchmarks of the hot paths, with machine-readable output for tracking regressions across versions
+ * p.PredictedMovement.Benchmark [Iterations] [Seed] [Characters] [PacketLoss]
+ *
+ * With Characters, that many scripted characters record their moves in a transient world, which are sent through
+ * the same move data and move response containers the network uses, dropping PacketLoss (0-1) of the packets
+ *
+ * The session totals of p.PredictedMovement.Stats are included, so running this after a session under
+ * NetEmulation.PktLag / NetEmulation.PktLoss also reports the correction rate and bytes per move in each direction
+ */
+namespace PredictedMovementBenchmark
+{
+	static constexpr int32 NumSamples = 1024;
+	static constexpr int32 NumLevels = 5;
+
+	/** 10 seconds of moves at 120 fps for each scripted character */
+	static constexpr int32 NumScriptedFrames = 1200;
+	static constexpr float ScriptedDeltaTime = 1.f / 120.f;
+
+	struct FResult
+	{
+		const TCHAR* Name;
+		double NsPerOp;
+		double BitsPerOp;
+	};
+
+	template<typename TFunc>
+	static double TimeNsPerOp(int32 Iterations, TFunc&& Func)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Func(i % NumSamples);
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1.e9 / Iterations;
+	}
+
+	static TModifierStack MakeStack(FRandomStream& Random)
+	{
+		TModifierStack Stack;
+		const int32 Num = Random.RandRange(0, 4);
+		for (int32 i = 0; i < Num; ++i)
+		{
+			Stack.Add(static_cast<TModSize>(Random.RandRange(0, NumLevels - 1)));
+		}
+		return Stack;
+	}
+
+	static void ToggleModifier(FMovementModifier& Modifier)
+	{
+		if (!Modifier.ResetModifiers())
+		{
+			Modifier.AddModifier(0);
+		}
+	}
+
+	/**
+	 * Scripted characters toggle Boost and SlowFall, and the server snares them now and then
+	 * Every second move is held back and sent as the pending move of the next, a lost packet's new move is sent
+	 * again as the old move of the next packet, the server acks each packet received or corrects a snare change
+	 */
+	static FString RunScriptedCharacters(int32 NumCharacters, float PacketLoss, FRandomStream& Random, uint64& Checksum)
+	{
+		const FPredictedMovementScopedWorld TestWorld;
+
+		uint64 ClientBits = 0;
+		uint64 ServerBits = 0;
+		int32 NumMoves = 0;
+		int32 NumPackets = 0;
+		int32 NumLostPackets = 0;
+		int32 NumCorrections = 0;
+		double Seconds = 0.0;
+
+		FNetBitWriter Writer(nullptr, 8192);
+		FNetBitReader Reader(nullptr, nullptr, 0);
+
+		for (int32 CharacterIndex = 0; CharacterIndex < NumCharacters; ++CharacterIndex)
+		{
+			AModifierCharacter* Character = TestWorld.SpawnActor<AModifierCharacter>();
+			UModifierMovement* MoveComp = Character ? Character->GetModifierCharacterMovement() : nullptr;
+			if (!MoveComp)
+			{
+				continue;
+			}
+
+			FNetworkPredictionData_Client_Character* ClientData = MoveComp->GetPredictionData_Client_Character();
+			FCharacterNetworkMoveDataContainer& MoveDataContainer = MoveComp->GetNetworkMoveDataContainer();
+			FCharacterMoveResponseDataContainer& ResponseContainer = MoveComp->GetMoveResponseDataContainer();
+			MoveComp->SetMovementMode(MOVE_Walking);
+
+			FSavedMovePtr PendingMove;
+			FSavedMovePtr LostMove;
+			bool bServerChanged = false;
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Frame = 0; Frame < NumScriptedFrames; ++Frame)
+			{
+				if (Random.FRand() < 0.02f) { ToggleModifier(MoveComp->BoostLocal); }
+				if (Random.FRand() < 0.01f) { ToggleModifier(MoveComp->SlowFallLocal); }
+				if (Random.FRand() < 0.005f)
+				{
+					TModifierStack& Snares = MoveComp->SnareServer.Modifiers;
+					if (Snares.Num() > 0)
+					{
+						Snares.Reset();
+					}
+					else
+					{
+						Snares.Add(0);
+					}
+					bServerChanged = true;
+				}
+
+				ClientData->CurrentTimeStamp += ScriptedDeltaTime;
+				FSavedMovePtr NewMove = ClientData->CreateSavedMove();
+				NewMove->SetMoveFor(Character, ScriptedDeltaTime, Random.VRand().GetSafeNormal2D() * 1000.f, *ClientData);
+				NumMoves++;
+
+				if (!PendingMove.IsValid())
+				{
+					PendingMove = NewMove;
+					continue;
+				}
+
+				// Client ➜ Server
+				Writer.Reset();
+				MoveDataContainer.ClientFillNetworkMoveData(NewMove.Get(), PendingMove.Get(), LostMove.Get());
+				MoveDataContainer.Serialize(*MoveComp, Writer, nullptr);
+				ClientBits += Writer.GetNumBits();
+				NumPackets++;
+
+				ClientData->FreeMove(PendingMove);
+				PendingMove.Reset();
+				if (LostMove.IsValid())
+				{
+					ClientData->FreeMove(LostMove);
+					LostMove.Reset();
+				}
+
+				if (Random.FRand() < PacketLoss)
+				{
+					LostMove = NewMove;
+					NumLostPackets++;
+					continue;
+				}
+
+				Reader.SetData(Writer.GetData(), Writer.GetNumBits());
+				MoveDataContainer.Serialize(*MoveComp, Reader, nullptr);
+				for (const TModifierStack& Stack : static_cast<const FModifierNetworkMoveData*>(MoveDataContainer.GetNewMoveData())->Stacks.WantsModifiers)
+				{
+					Checksum += Stack.Num();
+				}
+
+				// Server ➜ Client
+				FClientAdjustment Adjustment;
+				Adjustment.bAckGoodMove = !bServerChanged;
+				Adjustment.TimeStamp = NewMove->TimeStamp;
+				Adjustment.NewLoc = Character->GetActorLocation();
+				Adjustment.MovementMode = MoveComp->PackNetworkMovementMode();
+				NumCorrections += bServerChanged ? 1 : 0;
+				bServerChanged = false;
+
+				Writer.Reset();
+				ResponseContainer.ServerFillResponseData(*MoveComp, Adjustment);
+				ResponseContainer.Serialize(*MoveComp, Writer, nullptr);
+				ServerBits += Writer.GetNumBits();
+
+				Reader.SetData(Writer.GetData(), Writer.GetNumBits());
+				ResponseContainer.Serialize(*MoveComp, Reader, nullptr);
+				ClientData->FreeMove(NewMove);
+			}
+			Seconds += FPlatformTime::Seconds() - StartTime;
+
+			for (const FSavedMovePtr& Move : { PendingMove, LostMove })
+			{
+				if (Move.IsValid())
+				{
+					ClientData->FreeMove(Move);
+				}
+			}
+		}
+
+		const double Moves = FMath::Max(1, NumMoves);
+		return FString::Printf(TEXT("{\"characters\":%d,\"packet_loss\":%.3f,\"moves\":%d,\"packets\":%d,\"lost_packets\":%d,\"corrections\":%d,")
+			TEXT("\"ns_per_move\":%.3f,\"client_bytes_per_move\":%.3f,\"server_bytes_per_move\":%.3f}"),
+			NumCharacters, PacketLoss, NumMoves, NumPackets, NumLostPackets, NumCorrections,
+			Seconds * 1.e9 / Moves, ClientBits / 8.0 / Moves, ServerBits / 8.0 / Moves);
+	}
+
+	static void Run(const TArray<FString>& Args, FOutputDevice& Ar)
+	{
+		const int32 Iterations = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000);
+		const int32 Seed = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0;
+		const int32 NumCharacters = Args.Num() > 2 ? FMath::Max(0, FCString::Atoi(*Args[2])) : 0;
+		const float PacketLoss = Args.Num() > 3 ? FMath::Clamp(FCString::Atof(*Args[3]), 0.f, 1.f) : 0.f;
+
+		// Generate every input up front so only the code under test is timed
+		FRandomStream Random(Seed);
+		TArray<TModifierStack> Stacks[3];
+		TArray<FPredictedSimulatedState> States;
+		TArray<float> StaminaSamples;
+		for (TArray<TModifierStack>& SlotStacks : Stacks)
+		{
+			SlotStacks.Reserve(NumSamples);
+		}
+		States.Reserve(NumSamples);
+		StaminaSamples.Reserve(NumSamples);
+
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			for (TArray<TModifierStack>& SlotStacks : Stacks)
+			{
+				SlotStacks.Add(MakeStack(Random));
+			}
+
+			FPredictedSimulatedState& State = States.AddDefaulted_GetRef();
+			for (int32 Level = 0; Level < 3; ++Level)
+			{
+				State.SetLevel(Level, Random.FRand() < 0.5f ? static_cast<uint8>(Random.RandRange(0, NumLevels - 1)) : UINT8_MAX);
+			}
+
+			StaminaSamples.Add(Random.FRandRange(0.f, 100.f));
+		}
+
+		// Prevents the optimizer from removing the work
+		uint64 Checksum = 0;
+		TArray<FResult> Results;
+
+		// FModifierStatics::ProcessModifiers for a family of three slots, e.g. Boost
+		{
+			FMovementModifier Modifiers[3];
+			FMovementModifier* const ModifierPtrs[3] = { &Modifiers[0], &Modifiers[1], &Modifiers[2] };
+			TArray<FGameplayTag> LevelTags;
+			LevelTags.SetNum(NumLevels);
+			TModSize Level = NO_MODIFIER;
+
+			const double Ns = TimeNsPerOp(Iterations, [&](int32 Sample)
+			{
+				for (int32 Slot = 0; Slot < 3; ++Slot)
+				{
+					Modifiers[Slot].WantsModifiers = Stacks[Slot][Sample];
+				}
+				FModifierStatics::ProcessModifiers(Level, EModifierLevelMethod::Max, LevelTags, true, 8, NO_MODIFIER,
+					MakeArrayView(ModifierPtrs), [] { return true; });
+				Checksum += Level;
+			});
+			Results.Add({ TEXT("ProcessModifiers"), Ns, 0.0 });
+		}
+
+		// FModifierStatics::NetSerializePacked round trip, as sent with each move and correction
+		{
+			FNetBitWriter Writer(nullptr, 1024);
+			FNetBitReader Reader(nullptr, nullptr, 0);
+			uint64 TotalBits = 0;
+			const double Ns = TimeNsPerOp(Iterations, [&](int32 Sample)
+			{
+				TModifierStack Stack = Stacks[0][Sample];
+				Writer.Reset();
+				if (Stack.Num() > 0)
+				{
+					FModifierStatics::NetSerializePacked(Stack, Writer, TEXT("Benchmark"), NumLevels);
+				}
+				TotalBits += Writer.GetNumBits();
+
+				Reader.SetData(Writer.GetData(), Writer.GetNumBits());
+				TModifierStack Read;
+				if (Stack.Num() > 0)
+				{
+					FModifierStatics::NetSerializePacked(Read, Reader, TEXT("Benchmark"), NumLevels);
+				}
+				Checksum += Read.Num();
+			});
+			Results.Add({ TEXT("NetSerializePacked"), Ns, static_cast<double>(TotalBits) / Iterations });
+		}
+
+		// FPredictedSimulatedState::NetSerialize round trip, as replicated to simulated proxies
+		{
+			FNetBitWriter Writer(nullptr, 1024);
+			FNetBitReader Reader(nullptr, nullptr, 0);
+			uint64 TotalBits = 0;
+			const double Ns = TimeNsPerOp(Iterations, [&](int32 Sample)
+			{
+				bool bSuccess = true;
+				Writer.Reset();
+				States[Sample].NetSerialize(Writer, nullptr, bSuccess);
+				TotalBits += Writer.GetNumBits();
+
+				Reader.SetData(Writer.GetData(), Writer.GetNumBits());
+				FPredictedSimulatedState Read;
+				Read.NetSerialize(Reader, nullptr, bSuccess);
+				Checksum += Read.Levels.Num();
+			});
+			Results.Add({ TEXT("SimulatedStateNetSerialize"), Ns, static_cast<double>(TotalBits) / Iterations });
+		}
+
+		// FStaminaRateModel::Advance for a single physics subtick
+		{
+			const FStaminaRateModel Model;
+			const double Ns = TimeNsPerOp(Iterations, [&](int32 Sample)
+			{
+				bool bDrained = (Sample & 1) != 0;
+				const float Stamina = Model.Advance(StaminaSamples[Sample], bDrained, (Sample & 2) != 0, 100.f, 1.f / 60.f);
+				Checksum += static_cast<uint64>(Stamina);
+			});
+			Results.Add({ TEXT("StaminaRateModelAdvance"), Ns, 0.0 });
+		}
+
+		// Scripted characters sending their moves, see RunScriptedCharacters
+		const FString Scripted = NumCharacters > 0 ? RunScriptedCharacters(NumCharacters, PacketLoss, Random, Checksum) : TEXT("null");
+
+		FString Json = FString::Printf(TEXT("{\"engine\":\"%s\",\"iterations\":%d,\"seed\":%d,\"checksum\":%llu,\"benchmarks\":["),
+			*FEngineVersion::Current().ToString(), Iterations, Seed, Checksum);
+		for (int32 i = 0; i < Results.Num(); ++i)
+		{
+			Json += FString::Printf(TEXT("%s{\"name\":\"%s\",\"ns_per_op\":%.3f,\"bits_per_op\":%.3f}"),
+				i > 0 ? TEXT(",") : TEXT(""), Results[i].Name, Results[i].NsPerOp, Results[i].BitsPerOp);
+		}
+		Json += FString::Printf(TEXT("],\"scripted\":%s,\"session\":%s}"), *Scripted, *PredictedMovementStats::ToJson());
+
+		const FString FileName = FPaths::ProfilingDir() / TEXT("PredictedMovement") /
+			FString::Printf(TEXT("Benchmark_%s.json"), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Json, *FileName))
+		{
+			Ar.Logf(TEXT("PredictedMovement benchmark written to %s"), *IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*FileName));
+		}
+		Ar.Logf(TEXT("%s"), *Json);
+	}
+
+	static FAutoConsoleCommandWithArgsAndOutputDevice CmdBenchmark(
+		TEXT("p.PredictedMovement.Benchmark"),
+		TEXT("Benchmark modifier processing and serialization, and write the results with the p.PredictedMovement.Stats totals as JSON.\n")
+		TEXT("Characters scripted characters also send their moves with PacketLoss (0-1) of the packets dropped.\n")
+		TEXT("Usage: p.PredictedMovement.Benchmark [Iterations] [Seed] [Characters] [PacketLoss]"),
+		FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateStatic(&Run));
+}
+
+#endif
@@ -0,0 +1,39 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+/**
+ * A transient game world to drive characters outside of a play session, used by the benchmark and automation tests
+ * Anything spawned is destroyed with the world when this goes out of scope
+ */
+struct FPredictedMovementScopedWorld
+{
+	UWorld* World = nullptr;
+
+	FPredictedMovementScopedWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FPredictedMovementScopedWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	template<typename T>
+	T* SpawnActor() const
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		return World->SpawnActor<T>(SpawnParams);
+	}
+};
@@ -0,0 +1,72 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "System/PredictedMovementSignificance.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+
+namespace PredictedMovementSignificanceCVars
+{
+	static bool bProxyLOD = false;
+	FAutoConsoleVariableRef CVarProxyLOD(
+		TEXT("p.PredictedMovement.ProxyLOD"),
+		bProxyLOD,
+		TEXT("If true, replicated state changes of simulated proxies that are distant or not rendered are deferred until they are significant"),
+		ECVF_Default);
+
+	static float ProxyLODDistance = 5000.f;
+	FAutoConsoleVariableRef CVarProxyLODDistance(
+		TEXT("p.PredictedMovement.ProxyLOD.Distance"),
+		ProxyLODDistance,
+		TEXT("Simulated proxies further than this from every local camera are not significant, 0 to disable"),
+		ECVF_Default);
+
+	static float ProxyLODRenderTime = 1.f;
+	FAutoConsoleVariableRef CVarProxyLODRenderTime(
+		TEXT("p.PredictedMovement.ProxyLOD.RenderTime"),
+		ProxyLODRenderTime,
+		TEXT("Simulated proxies not rendered for this long are not significant, 0 to disable"),
+		ECVF_Default);
+}
+
+bool PredictedMovementSignificance::ShouldDeferSimulatedProxy(const ACharacter* Character)
+{
+	using namespace PredictedMovementSignificanceCVars;
+
+	if (!bProxyLOD || !Character || Character->GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		return false;
+	}
+
+	// Not seen recently
+	if (ProxyLODRenderTime > 0.f && !Character->WasRecentlyRendered(ProxyLODRenderTime))
+	{
+		return true;
+	}
+
+	// Too far from every local viewer
+	const UWorld* World = Character->GetWorld();
+	if (ProxyLODDistance > 0.f && World)
+	{
+		const FVector Location = Character->GetActorLocation();
+		bool bHasViewer = false;
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			const APlayerController* PC = It->Get();
+			if (PC && PC->IsLocalController() && PC->PlayerCameraManager)
+			{
+				bHasViewer = true;
+				if (FVector::DistSquared(PC->PlayerCameraManager->GetCameraLocation(), Location) <= FMath::Square(ProxyLODDistance))
+				{
+					return false;
+				}
+			}
+		}
+		return bHasViewer;
+	}
+
+	return false;
+}
@@ -0,0 +1,351 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "System/PredictedMovementStats.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Serialization/BitWriter.h"
+
+CSV_DEFINE_CATEGORY_MODULE(PREDICTEDMOVEMENT_API, PredictedMovement, true);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Movement"), STAT_PredictedMovement_CorrectionMovement, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Modifier"), STAT_PredictedMovement_CorrectionModifier, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Stamina"), STAT_PredictedMovement_CorrectionStamina, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Correction Stamina Segment"), STAT_PredictedMovement_CorrectionStaminaSegment, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bits Modifier Move Data"), STAT_PredictedMovement_BitsModifierMoveData, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bits Modifier Move Response"), STAT_PredictedMovement_BitsModifierMoveResponse, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bits Stamina Move Data"), STAT_PredictedMovement_BitsStaminaMoveData, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bits Stamina Move Response"), STAT_PredictedMovement_BitsStaminaMoveResponse, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Client Auth Full"), STAT_PredictedMovement_ClientAuthFull, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Client Auth Partial"), STAT_PredictedMovement_ClientAuthPartial, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Client Auth Rejected"), STAT_PredictedMovement_ClientAuthRejected, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Combined"), STAT_PredictedMovement_CombineCombined, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Combined Relaxed"), STAT_PredictedMovement_CombineCombinedRelaxed, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Rejected Base"), STAT_PredictedMovement_CombineRejectedBase, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Rejected Wants Modifiers"), STAT_PredictedMovement_CombineRejectedWantsModifiers, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Rejected Modifier Levels"), STAT_PredictedMovement_CombineRejectedModifierLevels, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Rejected Stamina Consuming"), STAT_PredictedMovement_CombineRejectedStaminaConsuming, STATGROUP_PredictedMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combine Rejected Stamina Drained"), STAT_PredictedMovement_CombineRejectedStaminaDrained, STATGROUP_PredictedMovement);
+
+namespace PredictedMovementStatsCVars
+{
+	static bool bStats = false;
+	static bool bStatsWasEnabled = false;
+
+	/** The totals and their start time restart when the stats are enabled, so rates aren't diluted by time spent disabled */
+	static void OnStatsChanged(IConsoleVariable* Var)
+	{
+		if (bStats && !bStatsWasEnabled)
+		{
+			PredictedMovementStats::Reset();
+		}
+		bStatsWasEnabled = bStats;
+	}
+
+	FAutoConsoleVariableRef CVarStats(
+		TEXT("p.PredictedMovement.Stats"),
+		bStats,
+		TEXT("If true, record corrections by cause, bits serialized by feature, client authority outcomes and move combining"),
+		FConsoleVariableDelegate::CreateStatic(&OnStatsChanged),
+		ECVF_Default);
+
+	static FAutoConsoleCommandWithOutputDevice CmdDump(
+		TEXT("p.PredictedMovement.Stats.Dump"),
+		TEXT("Print the totals recorded since p.PredictedMovement.Stats was enabled or last reset"),
+		FConsoleCommandWithOutputDeviceDelegate::CreateStatic(&PredictedMovementStats::Dump));
+
+	static FAutoConsoleCommand CmdReset(
+		TEXT("p.PredictedMovement.Stats.Reset"),
+		TEXT("Reset the totals recorded by p.PredictedMovement.Stats"),
+		FConsoleCommandDelegate::CreateStatic(&PredictedMovementStats::Reset));
+}
+
+namespace PredictedMovementStatsPrivate
+{
+	static const TCHAR* CorrectionNames[] = { TEXT("Movement"), TEXT("Modifier"), TEXT("Stamina"), TEXT("StaminaSegment") };
+	static const TCHAR* FeatureNames[] = { TEXT("ModifierMoveData"), TEXT("ModifierMoveResponse"), TEXT("StaminaMoveData"), TEXT("StaminaMoveResponse") };
+	static const TCHAR* ClientAuthNames[] = { TEXT("Full"), TEXT("Partial"), TEXT("Rejected") };
+	static const TCHAR* CombineNames[] = { TEXT("Combined"), TEXT("CombinedRelaxed"), TEXT("RejectedBase"), TEXT("RejectedWantsModifiers"),
+		TEXT("RejectedModifierLevels"), TEXT("RejectedStaminaConsuming"), TEXT("RejectedStaminaDrained") };
+
+#if CSV_PROFILER
+	// The CSV profiler keeps the pointer, these must be literals
+	static const char* CsvCorrectionNames[] = { "CorrectionMovement", "CorrectionModifier", "CorrectionStamina", "CorrectionStaminaSegment" };
+	static const char* CsvFeatureNames[] = { "BitsModifierMoveData", "BitsModifierMoveResponse", "BitsStaminaMoveData", "BitsStaminaMoveResponse" };
+	static const char* CsvClientAuthNames[] = { "ClientAuthFull", "ClientAuthPartial", "ClientAuthRejected" };
+	static const char* CsvCombineNames[] = { "CombineCombined", "CombineCombinedRelaxed", "CombineRejectedBase", "CombineRejectedWantsModifiers",
+		"CombineRejectedModifierLevels", "CombineRejectedStaminaConsuming", "CombineRejectedStaminaDrained" };
+#endif
+
+	static_assert(UE_ARRAY_COUNT(CorrectionNames) == static_cast<int32>(EPredictedCorrectionCause::Num), "Missing correction name");
+	static_assert(UE_ARRAY_COUNT(FeatureNames) == static_cast<int32>(EPredictedNetFeature::Num), "Missing feature name");
+	static_assert(UE_ARRAY_COUNT(ClientAuthNames) == static_cast<int32>(EPredictedClientAuthOutcome::Num), "Missing client auth name");
+	static_assert(UE_ARRAY_COUNT(CombineNames) == static_cast<int32>(EPredictedCombineResult::Num), "Missing combine name");
+
+	/** Depth of FPredictedMovementScopedNetWriter, only serialized from the game thread */
+	static int32 NetWriterDepth = 0;
+
+	/** Totals since the last reset, only written from the game thread */
+	struct FTotals
+	{
+		uint64 Corrections[static_cast<int32>(EPredictedCorrectionCause::Num)] = {};
+		uint64 SerializedBits[static_cast<int32>(EPredictedNetFeature::Num)] = {};
+		uint64 SerializeCount[static_cast<int32>(EPredictedNetFeature::Num)] = {};
+		uint64 ClientAuth[static_cast<int32>(EPredictedClientAuthOutcome::Num)] = {};
+		uint64 Combine[static_cast<int32>(EPredictedCombineResult::Num)] = {};
+		TMap<FName, uint64> CorrectionDetails;
+		double StartTime = FPlatformTime::Seconds();
+	};
+
+	static FTotals& GetTotals()
+	{
+		static FTotals Totals;
+		return Totals;
+	}
+}
+
+bool PredictedMovementStats::IsEnabled()
+{
+	return PredictedMovementStatsCVars::bStats;
+}
+
+void PredictedMovementStats::RecordCorrection(EPredictedCorrectionCause Cause, const TCHAR* Detail)
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	FTotals& Totals = GetTotals();
+	Totals.Corrections[static_cast<int32>(Cause)]++;
+	if (Detail)
+	{
+		Totals.CorrectionDetails.FindOrAdd(FName(Detail))++;
+	}
+
+	switch (Cause)
+	{
+	case EPredictedCorrectionCause::Movement: INC_DWORD_STAT(STAT_PredictedMovement_CorrectionMovement); break;
+	case EPredictedCorrectionCause::Modifier: INC_DWORD_STAT(STAT_PredictedMovement_CorrectionModifier); break;
+	case EPredictedCorrectionCause::Stamina: INC_DWORD_STAT(STAT_PredictedMovement_CorrectionStamina); break;
+	case EPredictedCorrectionCause::StaminaSegment: INC_DWORD_STAT(STAT_PredictedMovement_CorrectionStaminaSegment); break;
+	default: break;
+	}
+
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(CsvCorrectionNames[static_cast<int32>(Cause)],
+		CSV_CATEGORY_INDEX(PredictedMovement), 1, ECsvCustomStatOp::Accumulate);
+#endif
+}
+
+void PredictedMovementStats::RecordSerializedBits(EPredictedNetFeature Feature, int64 NumBits)
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	if (!IsEnabled() || NumBits <= 0)
+	{
+		return;
+	}
+
+	FTotals& Totals = GetTotals();
+	Totals.SerializedBits[static_cast<int32>(Feature)] += NumBits;
+	Totals.SerializeCount[static_cast<int32>(Feature)]++;
+
+	const uint32 Bits = static_cast<uint32>(NumBits);
+	switch (Feature)
+	{
+	case EPredictedNetFeature::ModifierMoveData: INC_DWORD_STAT_BY(STAT_PredictedMovement_BitsModifierMoveData, Bits); break;
+	case EPredictedNetFeature::ModifierMoveResponse: INC_DWORD_STAT_BY(STAT_PredictedMovement_BitsModifierMoveResponse, Bits); break;
+	case EPredictedNetFeature::StaminaMoveData: INC_DWORD_STAT_BY(STAT_PredictedMovement_BitsStaminaMoveData, Bits); break;
+	case EPredictedNetFeature::StaminaMoveResponse: INC_DWORD_STAT_BY(STAT_PredictedMovement_BitsStaminaMoveResponse, Bits); break;
+	default: break;
+	}
+
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(CsvFeatureNames[static_cast<int32>(Feature)],
+		CSV_CATEGORY_INDEX(PredictedMovement), static_cast<int32>(Bits), ECsvCustomStatOp::Accumulate);
+#endif
+}
+
+void PredictedMovementStats::RecordClientAuth(EPredictedClientAuthOutcome Outcome)
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	GetTotals().ClientAuth[static_cast<int32>(Outcome)]++;
+
+	switch (Outcome)
+	{
+	case EPredictedClientAuthOutcome::Full: INC_DWORD_STAT(STAT_PredictedMovement_ClientAuthFull); break;
+	case EPredictedClientAuthOutcome::Partial: INC_DWORD_STAT(STAT_PredictedMovement_ClientAuthPartial); break;
+	case EPredictedClientAuthOutcome::Rejected: INC_DWORD_STAT(STAT_PredictedMovement_ClientAuthRejected); break;
+	default: break;
+	}
+
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(CsvClientAuthNames[static_cast<int32>(Outcome)],
+		CSV_CATEGORY_INDEX(PredictedMovement), 1, ECsvCustomStatOp::Accumulate);
+#endif
+}
+
+void PredictedMovementStats::RecordCombine(EPredictedCombineResult Result)
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	GetTotals().Combine[static_cast<int32>(Result)]++;
+
+	switch (Result)
+	{
+	case EPredictedCombineResult::Combined: INC_DWORD_STAT(STAT_PredictedMovement_CombineCombined); break;
+	case EPredictedCombineResult::CombinedRelaxed: INC_DWORD_STAT(STAT_PredictedMovement_CombineCombinedRelaxed); break;
+	case EPredictedCombineResult::RejectedBase: INC_DWORD_STAT(STAT_PredictedMovement_CombineRejectedBase); break;
+	case EPredictedCombineResult::RejectedWantsModifiers: INC_DWORD_STAT(STAT_PredictedMovement_CombineRejectedWantsModifiers); break;
+	case EPredictedCombineResult::RejectedModifierLevels: INC_DWORD_STAT(STAT_PredictedMovement_CombineRejectedModifierLevels); break;
+	case EPredictedCombineResult::RejectedStaminaConsuming: INC_DWORD_STAT(STAT_PredictedMovement_CombineRejectedStaminaConsuming); break;
+	case EPredictedCombineResult::RejectedStaminaDrained: INC_DWORD_STAT(STAT_PredictedMovement_CombineRejectedStaminaDrained); break;
+	default: break;
+	}
+
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(CsvCombineNames[static_cast<int32>(Result)],
+		CSV_CATEGORY_INDEX(PredictedMovement), 1, ECsvCustomStatOp::Accumulate);
+#endif
+}
+
+int64 PredictedMovementStats::GetSerializedBits(const FArchive& Ar)
+{
+	// Only within FPredictedMovementScopedNetWriter is a saving net archive known to be a FBitWriter
+	if (!Ar.IsSaving() || !Ar.IsNetArchive() || PredictedMovementStatsPrivate::NetWriterDepth == 0)
+	{
+		return INDEX_NONE;
+	}
+	return static_cast<const FBitWriter&>(Ar).GetNumBits();
+}
+
+void PredictedMovementStats::PushNetWriter()
+{
+	PredictedMovementStatsPrivate::NetWriterDepth++;
+}
+
+void PredictedMovementStats::PopNetWriter()
+{
+	check(PredictedMovementStatsPrivate::NetWriterDepth > 0);
+	PredictedMovementStatsPrivate::NetWriterDepth--;
+}
+
+void PredictedMovementStats::Reset()
+{
+	PredictedMovementStatsPrivate::GetTotals() = {};
+}
+
+void PredictedMovementStats::Dump(FOutputDevice& Ar)
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	const FTotals& Totals = GetTotals();
+	const double Elapsed = FMath::Max(FPlatformTime::Seconds() - Totals.StartTime, UE_DOUBLE_KINDA_SMALL_NUMBER);
+
+	Ar.Logf(TEXT("PredictedMovement stats over %.1fs%s"), Elapsed, IsEnabled() ? TEXT("") : TEXT(" (p.PredictedMovement.Stats is disabled)"));
+
+	Ar.Logf(TEXT("Corrections:"));
+	for (int32 i = 0; i < static_cast<int32>(EPredictedCorrectionCause::Num); ++i)
+	{
+		Ar.Logf(TEXT("  %-24s %10llu  %8.2f/s"), CorrectionNames[i], Totals.Corrections[i], Totals.Corrections[i] / Elapsed);
+	}
+	for (const TPair<FName, uint64>& Detail : Totals.CorrectionDetails)
+	{
+		Ar.Logf(TEXT("    %-22s %10llu  %8.2f/s"), *Detail.Key.ToString(), Detail.Value, Detail.Value / Elapsed);
+	}
+
+	Ar.Logf(TEXT("Serialized:"));
+	for (int32 i = 0; i < static_cast<int32>(EPredictedNetFeature::Num); ++i)
+	{
+		const uint64 Count = Totals.SerializeCount[i];
+		Ar.Logf(TEXT("  %-24s %10llu bytes  %8.2f bytes/s  %6.2f bits avg"), FeatureNames[i],
+			Totals.SerializedBits[i] / 8, Totals.SerializedBits[i] / (8.0 * Elapsed),
+			Count > 0 ? static_cast<double>(Totals.SerializedBits[i]) / Count : 0.0);
+	}
+
+	uint64 ClientAuthTotal = 0;
+	for (int32 i = 0; i < static_cast<int32>(EPredictedClientAuthOutcome::Num); ++i)
+	{
+		ClientAuthTotal += Totals.ClientAuth[i];
+	}
+
+	Ar.Logf(TEXT("Client Auth:"));
+	for (int32 i = 0; i < static_cast<int32>(EPredictedClientAuthOutcome::Num); ++i)
+	{
+		Ar.Logf(TEXT("  %-24s %10llu  %6.2f%%"), ClientAuthNames[i], Totals.ClientAuth[i],
+			ClientAuthTotal > 0 ? 100.0 * Totals.ClientAuth[i] / ClientAuthTotal : 0.0);
+	}
+
+	// Every combined move is a move that wasn't sent
+	uint64 CombineTotal = 0;
+	for (int32 i = 0; i < static_cast<int32>(EPredictedCombineResult::Num); ++i)
+	{
+		CombineTotal += Totals.Combine[i];
+	}
+
+	Ar.Logf(TEXT("Move Combining:"));
+	for (int32 i = 0; i < static_cast<int32>(EPredictedCombineResult::Num); ++i)
+	{
+		Ar.Logf(TEXT("  %-24s %10llu  %6.2f%%"), CombineNames[i], Totals.Combine[i],
+			CombineTotal > 0 ? 100.0 * Totals.Combine[i] / CombineTotal : 0.0);
+	}
+}
+
+FString PredictedMovementStats::ToJson()
+{
+	using namespace PredictedMovementStatsPrivate;
+
+	const FTotals& Totals = GetTotals();
+	const double Elapsed = FMath::Max(FPlatformTime::Seconds() - Totals.StartTime, UE_DOUBLE_KINDA_SMALL_NUMBER);
+
+	FString Json = FString::Printf(TEXT("{\"enabled\":%s,\"seconds\":%.3f,\"corrections\":{"), IsEnabled() ? TEXT("true") : TEXT("false"), Elapsed);
+	for (int32 i = 0; i < static_cast<int32>(EPredictedCorrectionCause::Num); ++i)
+	{
+		Json += FString::Printf(TEXT("%s\"%s\":%llu"), i > 0 ? TEXT(",") : TEXT(""), CorrectionNames[i], Totals.Corrections[i]);
+	}
+
+	Json += TEXT("},\"correction_details\":{");
+	bool bFirst = true;
+	for (const TPair<FName, uint64>& Detail : Totals.CorrectionDetails)
+	{
+		Json += FString::Printf(TEXT("%s\"%s\":%llu"), bFirst ? TEXT("") : TEXT(","), *Detail.Key.ToString(), Detail.Value);
+		bFirst = false;
+	}
+
+	Json += TEXT("},\"serialized\":{");
+	for (int32 i = 0; i < static_cast<int32>(EPredictedNetFeature::Num); ++i)
+	{
+		const uint64 Count = Totals.SerializeCount[i];
+		Json += FString::Printf(TEXT("%s\"%s\":{\"count\":%llu,\"bits\":%llu,\"bytes_per_second\":%.3f}"), i > 0 ? TEXT(",") : TEXT(""),
+			FeatureNames[i], Count, Totals.SerializedBits[i], Totals.SerializedBits[i] / (8.0 * Elapsed));
+	}
+
+	Json += TEXT("},\"client_auth\":{");
+	for (int32 i = 0; i < static_cast<int32>(EPredictedClientAuthOutcome::Num); ++i)
+	{
+		Json += FString::Printf(TEXT("%s\"%s\":%llu"), i > 0 ? TEXT(",") : TEXT(""), ClientAuthNames[i], Totals.ClientAuth[i]);
+	}
+
+	Json += TEXT("},\"combine\":{");
+	for (int32 i = 0; i < static_cast<int32>(EPredictedCombineResult::Num); ++i)
+	{
+		Json += FString::Printf(TEXT("%s\"%s\":%llu"), i > 0 ? TEXT(",") : TEXT(""), CombineNames[i], Totals.Combine[i]);
+	}
+
+	Json += TEXT("}}");
+	return Json;
+}
@@ -0,0 +1,129 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "System/PredictedMovementTrace.h"
+
+#if PREDICTED_MOVEMENT_TRACE_ENABLED
+
+#include "GameplayTagContainer.h"
+#include "HAL/PlatformTime.h"
+
+UE_TRACE_CHANNEL_DEFINE(PredictedMovementChannel);
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, SavedMove)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Step)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+	UE_TRACE_EVENT_FIELD(float, DeltaTime)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, Combine)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Result)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, Correction)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Cause)
+	UE_TRACE_EVENT_FIELD(float, TimeStamp)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Detail)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, ClientAuthGrant)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(float, Duration)
+	UE_TRACE_EVENT_FIELD(int32, Priority)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Source)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, ClientAuth)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Outcome)
+	UE_TRACE_EVENT_FIELD(float, Alpha)
+	UE_TRACE_EVENT_FIELD(float, Distance)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(PredictedMovement, ProneAttempt)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ObjectId)
+	UE_TRACE_EVENT_FIELD(uint8, Attempt)
+	UE_TRACE_EVENT_FIELD(uint8, Result)
+	UE_TRACE_EVENT_FIELD(uint16, NumQueries)
+UE_TRACE_EVENT_END()
+
+namespace PredictedMovementTracePrivate
+{
+	static uint32 GetObjectId(const UObject* Owner)
+	{
+		return Owner ? Owner->GetUniqueID() : 0;
+	}
+}
+
+void PredictedMovementTrace::OutputSavedMove(const UObject* Owner, EPredictedSavedMoveStep Step, float TimeStamp, float DeltaTime)
+{
+	UE_TRACE_LOG(PredictedMovement, SavedMove, PredictedMovementChannel)
+		<< SavedMove.Cycle(FPlatformTime::Cycles64())
+		<< SavedMove.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< SavedMove.Step(static_cast<uint8>(Step))
+		<< SavedMove.TimeStamp(TimeStamp)
+		<< SavedMove.DeltaTime(DeltaTime);
+}
+
+void PredictedMovementTrace::OutputCombine(const UObject* Owner, EPredictedCombineResult Result, float TimeStamp)
+{
+	UE_TRACE_LOG(PredictedMovement, Combine, PredictedMovementChannel)
+		<< Combine.Cycle(FPlatformTime::Cycles64())
+		<< Combine.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< Combine.Result(static_cast<uint8>(Result))
+		<< Combine.TimeStamp(TimeStamp);
+}
+
+void PredictedMovementTrace::OutputCorrection(const UObject* Owner, EPredictedCorrectionCause Cause, const TCHAR* Detail, float TimeStamp)
+{
+	const TCHAR* DetailStr = Detail ? Detail : TEXT("");
+	UE_TRACE_LOG(PredictedMovement, Correction, PredictedMovementChannel)
+		<< Correction.Cycle(FPlatformTime::Cycles64())
+		<< Correction.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< Correction.Cause(static_cast<uint8>(Cause))
+		<< Correction.TimeStamp(TimeStamp)
+		<< Correction.Detail(DetailStr, FCString::Strlen(DetailStr));
+}
+
+void PredictedMovementTrace::OutputClientAuthGrant(const UObject* Owner, const FGameplayTag& Source, float Duration, int32 Priority)
+{
+	const FString SourceStr = Source.ToString();
+	UE_TRACE_LOG(PredictedMovement, ClientAuthGrant, PredictedMovementChannel)
+		<< ClientAuthGrant.Cycle(FPlatformTime::Cycles64())
+		<< ClientAuthGrant.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< ClientAuthGrant.Duration(Duration)
+		<< ClientAuthGrant.Priority(Priority)
+		<< ClientAuthGrant.Source(*SourceStr, SourceStr.Len());
+}
+
+void PredictedMovementTrace::OutputClientAuth(const UObject* Owner, EPredictedClientAuthOutcome Outcome, float Alpha, float Distance)
+{
+	UE_TRACE_LOG(PredictedMovement, ClientAuth, PredictedMovementChannel)
+		<< ClientAuth.Cycle(FPlatformTime::Cycles64())
+		<< ClientAuth.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< ClientAuth.Outcome(static_cast<uint8>(Outcome))
+		<< ClientAuth.Alpha(Alpha)
+		<< ClientAuth.Distance(Distance);
+}
+
+void PredictedMovementTrace::OutputProneAttempt(const UObject* Owner, EPredictedProneAttempt Attempt, EPredictedProneResult Result, int32 NumQueries)
+{
+	UE_TRACE_LOG(PredictedMovement, ProneAttempt, PredictedMovementChannel)
+		<< ProneAttempt.Cycle(FPlatformTime::Cycles64())
+		<< ProneAttempt.ObjectId(PredictedMovementTracePrivate::GetObjectId(Owner))
+		<< ProneAttempt.Attempt(static_cast<uint8>(Attempt))
+		<< ProneAttempt.Result(static_cast<uint8>(Result))
+		<< ProneAttempt.NumQueries(static_cast<uint16>(FMath::Clamp(NumQueries, 0, MAX_uint16)));
+}
+
+#endif
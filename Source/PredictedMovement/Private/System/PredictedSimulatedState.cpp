@@ -0,0 +1,34 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "System/PredictedSimulatedState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PredictedSimulatedState)
+
+bool FPredictedSimulatedState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 NumLevels = Levels.Num();
+	Ar.SerializeInt(NumLevels, MAX_SIMULATED_STATE_LEVELS + 1);
+	if (Ar.IsLoading())
+	{
+		Levels.SetNumUninitialized(FMath::Min<int32>(NumLevels, MAX_SIMULATED_STATE_LEVELS));
+	}
+
+	// Most levels are inactive most of the time, those only cost a single bit
+	for (uint8& Level : Levels)
+	{
+		uint8 bActive = Ar.IsLoading() ? 0 : Level != UINT8_MAX;
+		Ar.SerializeBits(&bActive, 1);
+		if (bActive)
+		{
+			Ar << Level;
+		}
+		else
+		{
+			Level = UINT8_MAX;
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
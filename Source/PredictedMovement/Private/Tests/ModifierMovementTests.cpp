@@ -0,0 +1,233 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "Modifier/ModifierCharacter.h"
+#include "Modifier/ModifierMovement.h"
+#include "Modifier/ModifierMovementSubsystem.h"
+#include "System/PredictedMovementScopedWorld.h"
+#include "System/PredictedMovementVersioning.h"
+#include "Tests/PredictedMovementTestTypes.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/CoreNet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#if UE_5_05_OR_LATER
+#define PREDICTED_MOVEMENT_TEST_FLAGS (EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#else
+#define PREDICTED_MOVEMENT_TEST_FLAGS (EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#endif
+
+namespace ModifierMovementTests
+{
+	static const FModifierStacks& GetStacks(const FSavedMovePtr& Move)
+	{
+		return static_cast<const FSavedMove_Character_Modifier*>(Move.Get())->Stacks;
+	}
+
+	static FModifierNetworkMoveData& GetMoveData(FCharacterNetworkMoveData* MoveData)
+	{
+		return *static_cast<FModifierNetworkMoveData*>(MoveData);
+	}
+}
+
+/**
+ * Record saved moves, send them through the move data container the server receives them with, then replay one
+ * Also sends a correction back through the move response container
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModifierMovementSavedMoveTest, "PredictedMovement.Modifier.SavedMove", PREDICTED_MOVEMENT_TEST_FLAGS)
+
+bool FModifierMovementSavedMoveTest::RunTest(const FString& Parameters)
+{
+	using namespace ModifierMovementTests;
+
+	const FPredictedMovementScopedWorld TestWorld;
+	AModifierCharacter* Character = TestWorld.SpawnActor<AModifierCharacter>();
+	UModifierMovement* MoveComp = Character ? Character->GetModifierCharacterMovement() : nullptr;
+	if (!TestNotNull(TEXT("ModifierMovement"), MoveComp))
+	{
+		return false;
+	}
+
+	FNetworkPredictionData_Client_Character* ClientData = MoveComp->GetPredictionData_Client_Character();
+	const FModifierRegistry& Registry = MoveComp->GetModifierRegistry();
+	MoveComp->SetMovementMode(MOVE_Falling);
+
+	auto RecordMove = [Character, ClientData]
+	{
+		const float DeltaTime = 1.f / 60.f;
+		ClientData->CurrentTimeStamp += DeltaTime;
+		FSavedMovePtr Move = ClientData->CreateSavedMove();
+		Move->SetMoveFor(Character, DeltaTime, FVector::ForwardVector * 1000.f, *ClientData);
+		return Move;
+	};
+
+	// An old move without modifiers, followed by a pending and new move with the same input
+	const FSavedMovePtr OldMove = RecordMove();
+	MoveComp->BoostLocal.AddModifier(0);
+	MoveComp->BoostLocal.AddModifier(0);
+	MoveComp->SlowFallLocal.AddModifier(0);
+	const FSavedMovePtr PendingMove = RecordMove();
+	const FSavedMovePtr NewMove = RecordMove();
+
+	FModifierStacks Wanted;
+	Registry.GatherWantsModifiers(Wanted);
+	TestTrue(TEXT("SetMoveFor gathers WantsModifiers"), GetStacks(NewMove) == Wanted);
+	TestTrue(TEXT("The old move has no modifiers"), GetStacks(OldMove) != Wanted);
+
+	// Client ➜ Server, read back into the container the component receives moves with
+	{
+		FCharacterNetworkMoveDataContainer& MoveDataContainer = MoveComp->GetNetworkMoveDataContainer();
+		MoveDataContainer.ClientFillNetworkMoveData(NewMove.Get(), PendingMove.Get(), OldMove.Get());
+
+		FNetBitWriter Writer(nullptr, 8192);
+		TestTrue(TEXT("Move data serializes"), MoveDataContainer.Serialize(*MoveComp, Writer, nullptr));
+
+		FModifierNetworkMoveData& NewMoveData = GetMoveData(MoveDataContainer.GetNewMoveData());
+		FModifierNetworkMoveData& PendingMoveData = GetMoveData(MoveDataContainer.GetPendingMoveData());
+		FModifierNetworkMoveData& OldMoveData = GetMoveData(MoveDataContainer.GetOldMoveData());
+		NewMoveData.Stacks.Reset();
+		PendingMoveData.Stacks.Reset();
+		OldMoveData.Stacks.Reset();
+
+		FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+		TestTrue(TEXT("Move data deserializes"), MoveDataContainer.Serialize(*MoveComp, Reader, nullptr));
+		TestFalse(TEXT("Move data reads every bit"), Reader.IsError() || Reader.GetBitsLeft() > 0);
+
+		TestTrue(TEXT("New move stacks"), NewMoveData.Stacks == GetStacks(NewMove));
+		TestTrue(TEXT("Pending move stacks, sent as the same as the new move"), PendingMoveData.Stacks == GetStacks(PendingMove));
+		TestTrue(TEXT("Old move stacks"), OldMoveData.Stacks == GetStacks(OldMove));
+	}
+
+	// Replay the new move after a correction, starting from no modifiers at all
+	{
+		MoveComp->BoostLocal.ResetModifiers();
+		MoveComp->SlowFallLocal.ResetModifiers();
+		MoveComp->UpdateModifierMovementState();
+		TestFalse(TEXT("Boost inactive before replay"), MoveComp->IsBoostActive());
+
+		NewMove->PrepMoveFor(Character);
+		MoveComp->SetMovementMode(MOVE_Falling);
+
+		FModifierStacks Replayed;
+		Registry.GatherWantsModifiers(Replayed);
+		TestTrue(TEXT("PrepMoveFor restores WantsModifiers"), Replayed == GetStacks(NewMove));
+
+		MoveComp->UpdateModifierMovementState();
+		MoveComp->SetReplayResolvePasses(nullptr);
+		TestTrue(TEXT("Replayed move activates Boost"), MoveComp->IsBoostActive());
+		TestTrue(TEXT("Replayed move activates SlowFall"), MoveComp->IsSlowFallActive());
+	}
+
+	// Server ➜ Client, a correction carries the modifiers of the corrected slots
+	{
+		MoveComp->SnareServer.Modifiers.Reset();
+		MoveComp->SnareServer.Modifiers.Add(0);
+
+		FClientAdjustment Adjustment;
+		Adjustment.bAckGoodMove = false;
+		Adjustment.TimeStamp = NewMove->TimeStamp;
+		Adjustment.NewLoc = Character->GetActorLocation();
+		Adjustment.MovementMode = MoveComp->PackNetworkMovementMode();
+
+		FModifierMoveResponseDataContainer& Response = static_cast<FModifierMoveResponseDataContainer&>(
+			MoveComp->GetMoveResponseDataContainer());
+		Response.ServerFillResponseData(*MoveComp, Adjustment);
+
+		FNetBitWriter Writer(nullptr, 8192);
+		TestTrue(TEXT("Correction serializes"), Response.Serialize(*MoveComp, Writer, nullptr));
+
+		for (TModifierStack& Stack : Response.Modifiers)
+		{
+			Stack.Reset();
+		}
+
+		FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+		TestTrue(TEXT("Correction deserializes"), Response.Serialize(*MoveComp, Reader, nullptr));
+		TestTrue(TEXT("Correction is received as a correction"), Response.IsCorrection());
+
+		const FModifierSlot* Slot = Registry.FindSlot(static_cast<int32>(EModifierType::Snare), EModifierNetType::ServerInitiated);
+		if (TestNotNull(TEXT("SnareServer slot"), Slot))
+		{
+			TestTrue(TEXT("Correction carries SnareServer"), Response.Modifiers[Slot->ModifiersIndex] == MoveComp->SnareServer.Modifiers);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * With bEvaluateClientAuthPerPacket only the new move of each packet is tested for client authority
+ * This must hold whether the moves are performed as they are received or batched by UModifierMovementSubsystem
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FModifierMovementBatchedClientAuthTest, "PredictedMovement.Modifier.BatchedClientAuth", PREDICTED_MOVEMENT_TEST_FLAGS)
+
+bool FModifierMovementBatchedClientAuthTest::RunTest(const FString& Parameters)
+{
+	IConsoleVariable* BatchCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("p.Modifier.BatchServerMoves"));
+	if (!TestNotNull(TEXT("p.Modifier.BatchServerMoves"), BatchCVar))
+	{
+		return false;
+	}
+	const bool bWasBatching = BatchCVar->GetBool();
+
+	const FPredictedMovementScopedWorld TestWorld;
+	AModifierCharacterTest* Character = TestWorld.SpawnActor<AModifierCharacterTest>();
+	UModifierMovementTest* MoveComp = Character ? Cast<UModifierMovementTest>(Character->GetModifierCharacterMovement()) : nullptr;
+	UModifierMovementSubsystem* Subsystem = TestWorld.World->GetSubsystem<UModifierMovementSubsystem>();
+	if (!TestNotNull(TEXT("ModifierMovementTest"), MoveComp) || !TestNotNull(TEXT("ModifierMovementSubsystem"), Subsystem))
+	{
+		return false;
+	}
+	MoveComp->bEvaluateClientAuthPerPacket = true;
+
+	// Two packets, each with a pending and a new move
+	auto SendPackets = [MoveComp]
+	{
+		FCharacterNetworkMoveDataContainer& MoveDataContainer = MoveComp->GetNetworkMoveDataContainer();
+		for (int32 Packet = 0; Packet < 2; ++Packet)
+		{
+			MoveDataContainer.bHasPendingMove = true;
+			MoveDataContainer.bHasOldMove = false;
+			MoveDataContainer.bIsDualMove = false;
+			MoveDataContainer.bIsDualHybridRootMotionMove = false;
+			MoveDataContainer.GetPendingMoveData()->TimeStamp = Packet * 2.f + 1.f;
+			MoveDataContainer.GetNewMoveData()->TimeStamp = Packet * 2.f + 2.f;
+			MoveComp->HandleMoveData(MoveDataContainer);
+		}
+	};
+
+	auto TestPerformedMoves = [this, MoveComp](const TCHAR* What)
+	{
+		if (TestEqual(FString::Printf(TEXT("%s performs every move"), What), MoveComp->PerformedMoves.Num(), 4))
+		{
+			for (const FModifierMovementTestMove& Move : MoveComp->PerformedMoves)
+			{
+				// Even timestamps are the new moves
+				const bool bNewMove = FMath::RoundToInt(Move.TimeStamp) % 2 == 0;
+				TestEqual(FString::Printf(TEXT("%s tests client authority for new moves only, move %.0f"), What, Move.TimeStamp),
+					Move.bClientAuthEvaluated, bNewMove);
+			}
+		}
+		MoveComp->PerformedMoves.Reset();
+	};
+
+	BatchCVar->Set(false, ECVF_SetByCode);
+	SendPackets();
+	TestPerformedMoves(TEXT("Unbatched"));
+
+	BatchCVar->Set(true, ECVF_SetByCode);
+	SendPackets();
+	TestTrue(TEXT("Batched moves are queued"), MoveComp->HasQueuedServerMoves() && MoveComp->PerformedMoves.Num() == 0);
+	Subsystem->PerformPendingServerMoves();
+	TestPerformedMoves(TEXT("Batched"));
+
+	BatchCVar->Set(bWasBatching, ECVF_SetByCode);
+	return true;
+}
+
+#undef PREDICTED_MOVEMENT_TEST_FLAGS
+
+#endif
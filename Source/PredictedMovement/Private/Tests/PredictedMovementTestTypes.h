@@ -0,0 +1,49 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modifier/ModifierCharacter.h"
+#include "Modifier/ModifierMovement.h"
+#include "PredictedMovementTestTypes.generated.h"
+
+/** A move performed by UModifierMovementTest */
+struct FModifierMovementTestMove
+{
+	float TimeStamp = 0.f;
+	bool bClientAuthEvaluated = false;
+};
+
+/**
+ * Exposes the server move entry point to the automation tests
+ * Moves are recorded instead of performed, performing them needs a client connection
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UModifierMovementTest : public UModifierMovement
+{
+	GENERATED_BODY()
+
+public:
+	TArray<FModifierMovementTestMove> PerformedMoves;
+
+	void HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer)
+	{
+		ServerMove_HandleMoveData(MoveDataContainer);
+	}
+
+	virtual void ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData) override
+	{
+		PerformedMoves.Add({ MoveData.TimeStamp, IsClientAuthEvaluatedForCurrentMove() });
+	}
+};
+
+UCLASS(Transient, NotBlueprintable, NotPlaceable, HideDropdown)
+class AModifierCharacterTest : public AModifierCharacter
+{
+	GENERATED_BODY()
+
+public:
+	AModifierCharacterTest(const FObjectInitializer& FObjectInitializer)
+		: Super(FObjectInitializer.SetDefaultSubobjectClass<UModifierMovementTest>(CharacterMovementComponentName))
+	{}
+};
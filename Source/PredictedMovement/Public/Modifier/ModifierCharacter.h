@@ -5,10 +5,12 @@
 #include "CoreMinimal.h"
 #include "GameplayTagContainer.h"
 #include "ModifierTypes.h"
+#include "System/PredictedSimulatedState.h"
 #include "GameFramework/Character.h"
 #include "ModifierCharacter.generated.h"
 
 class UModifierMovement;
+struct FMovementModifier;
 
 /**
  * Supports stackable modifiers such as Boost, Snare, and SlowFall.
@@ -31,27 +33,53 @@ public:
 	AModifierCharacter(const FObjectInitializer& FObjectInitializer);
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	virtual void BeginPlay() override;
+
+public:
+	/** Checksum of the server's modifier level tables, level indices are only meaningful if ours match */
+	UPROPERTY(ReplicatedUsing=OnRep_ModifierTableChecksum)
+	uint32 ModifierTableChecksum = 0;
+
+	/** Fail fast if the server's modifier level tables differ from ours */
+	UFUNCTION()
+	virtual void OnRep_ModifierTableChecksum();
 	
 public:
+	/**
+	 * Called by character movement when a family's level changes
+	 * @param FamilyIndex The family in UModifierMovement::GetModifierRegistry(), EModifierType for built-in families
+	 * Native overrides should switch on FamilyIndex, the tags are passed on for Blueprint
+	 */
 	template<typename T>
-	void NotifyModifierChanged(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel,
+	void NotifyModifierChanged(int32 FamilyIndex, const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel,
 		const FGameplayTag& PrevModifierLevel, T ModifierLevelValue, T PrevModifierLevelValue, T InvalidLevel)
 	{
 		if (ModifierLevelValue != InvalidLevel && PrevModifierLevelValue == InvalidLevel)
 		{
-			OnModifierAdded(ModifierType, ModifierLevel, PrevModifierLevel);
+			OnModifierAdded(FamilyIndex, ModifierType, ModifierLevel, PrevModifierLevel);
 		}
 		else if (ModifierLevelValue == InvalidLevel && PrevModifierLevelValue != InvalidLevel)
 		{
-			OnModifierRemoved(ModifierType, ModifierLevel, PrevModifierLevel);
+			OnModifierRemoved(FamilyIndex, ModifierType, ModifierLevel, PrevModifierLevel);
 		}
 		
-		OnModifierChanged(ModifierType, ModifierLevel, PrevModifierLevel);
+		OnModifierChanged(FamilyIndex, ModifierType, ModifierLevel, PrevModifierLevel);
 	}
 	
-	virtual void OnModifierChanged(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
-	virtual void OnModifierAdded(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
-	virtual void OnModifierRemoved(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
+	virtual void OnModifierChanged(int32 FamilyIndex, const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
+	virtual void OnModifierAdded(int32 FamilyIndex, const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
+	virtual void OnModifierRemoved(int32 FamilyIndex, const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
+
+	/** Called by the FamilyIndex overloads before they broadcast, kept so existing overrides are still called */
+	UE_DEPRECATED(5.5, "Override the OnModifierChanged overload that takes FamilyIndex instead")
+	virtual void OnModifierChanged(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel) {}
+
+	UE_DEPRECATED(5.5, "Override the OnModifierAdded overload that takes FamilyIndex instead")
+	virtual void OnModifierAdded(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel) {}
+
+	UE_DEPRECATED(5.5, "Override the OnModifierRemoved overload that takes FamilyIndex instead")
+	virtual void OnModifierRemoved(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel) {}
 
 	UFUNCTION(BlueprintImplementableEvent, Category=Character, meta=(DisplayName="On Modifier Added"))
 	void K2_OnModifierAdded(const FGameplayTag& ModifierType, const FGameplayTag& ModifierLevel, const FGameplayTag& PrevModifierLevel);
@@ -70,18 +98,142 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category="Character Movement (Networking)")
 	virtual void GrantClientAuthority(FGameplayTag ClientAuthSource, float OverrideDuration = -1.f);
-	
+
 public:
-	/* Boost Implementation */
-	
-	/** Set by character movement to specify that this Character's Boost level. */
+	/**
+	 * This Character's level of every modifier family, mirrored from whichever properties are replicated
+	 * Indexed by family, @see UModifierMovement::GetModifierRegistry()
+	 */
+	TArray<uint8> SimulatedModifierLevels;
+
+	/** Set by character movement to specify that this Character's Boost level, replicated when not packed */
 	UPROPERTY(ReplicatedUsing=OnRep_SimulatedBoost)
 	uint8 SimulatedBoost = NO_MODIFIER;
 
+	/** Set by character movement to specify that this Character's Snare level, replicated when not packed */
+	UPROPERTY(ReplicatedUsing=OnRep_SimulatedSnare)
+	uint8 SimulatedSnare = NO_MODIFIER;
+
+	/** Set by character movement to specify that this Character's SlowFall level, replicated when not packed */
+	UPROPERTY(ReplicatedUsing=OnRep_SimulatedSlowFall)
+	uint8 SimulatedSlowFall = NO_MODIFIER;
+
+	/**
+	 * Levels of the families registered after the built-in EModifierType families, replicated when not packed
+	 * Indexed by family - EModifierType::Num, empty unless you register your own families
+	 */
+	UPROPERTY(ReplicatedUsing=OnRep_SimulatedCustomModifierLevels)
+	TArray<uint8> SimulatedCustomModifierLevels;
+
+	/**
+	 * If true, simulated proxies receive SimulatedState instead of SimulatedBoost, SimulatedSnare, SimulatedSlowFall
+	 * and SimulatedCustomModifierLevels
+	 * Every family's level is bit-packed into a single property with a single OnRep
+	 */
+	UPROPERTY(EditDefaultsOnly, Category=Replication)
+	bool bReplicatePackedSimulatedState = true;
+
+	/**
+	 * Packed simulated modifier levels, replicated when bReplicatePackedSimulatedState is true
+	 * Levels are indexed by family, @see UModifierMovement::GetModifierRegistry()
+	 */
+	UPROPERTY(ReplicatedUsing=OnRep_SimulatedState)
+	FPredictedSimulatedState SimulatedState;
+
+	/** Routes changes to OnRep_SimulatedModifierLevels */
+	UFUNCTION()
+	virtual void OnRep_SimulatedState(const FPredictedSimulatedState& PrevState);
+
 	/** Handle Boost replicated from server */
 	UFUNCTION()
 	virtual void OnRep_SimulatedBoost(uint8 PrevLevel);
 
+	/** Handle Snare replicated from server */
+	UFUNCTION()
+	virtual void OnRep_SimulatedSnare(uint8 PrevLevel);
+
+	/** Handle SlowFall replicated from server */
+	UFUNCTION()
+	virtual void OnRep_SimulatedSlowFall(uint8 PrevLevel);
+
+	/** Handle the levels of your own families replicated from server */
+	UFUNCTION()
+	virtual void OnRep_SimulatedCustomModifierLevels();
+
+	/** Handle modifier levels replicated from server, SimulatedModifierLevels has been updated from PrevLevels */
+	virtual void OnRep_SimulatedModifierLevels(const TArray<uint8>& PrevLevels);
+
+protected:
+	/** Mirror a replicated family level into SimulatedModifierLevels, then call OnRep_SimulatedModifierLevels */
+	void OnRep_SimulatedFamilyLevel(int32 FamilyIndex, uint8 Level);
+
+	/** Server only: set the replicated property of a family's level */
+	void SetReplicatedFamilyLevel(int32 FamilyIndex, uint8 Level);
+
+public:
+
+	/** Apply deferred SimulatedModifierLevels once this simulated proxy is significant again */
+	void FlushDeferredModifierRep();
+	bool HasDeferredModifierRep() const { return bDeferredModifierRep; }
+
+protected:
+	/**
+	 * SimulatedModifierLevels last applied, while changes of a simulated proxy that isn't significant are deferred
+	 * @see PredictedMovementSignificance
+	 */
+	TArray<uint8> DeferredPrevModifierLevels;
+	bool bDeferredModifierRep = false;
+
+	/** Apply SimulatedModifierLevels to the movement component, notifying every family that changed since PrevLevels */
+	virtual void ApplySimulatedModifierLevels(const TArray<uint8>& PrevLevels);
+
+public:
+	/**
+	 * Request the character to add a modifier. The request is processed on the next update of the CharacterMovementComponent.
+	 * @param ModifierType The type of modifier to add, e.g. Modifier.Boost
+	 * @param Level The level of the modifier to add.
+	 * @param NetType How the modifier is applied, ServerInitiated modifiers can only be added by the server.
+	 * @return True if the modifier was added.
+	 */
+	UFUNCTION(BlueprintCallable, Category=Character)
+	virtual bool AddModifier(FGameplayTag ModifierType, FGameplayTag Level, EModifierNetType NetType);
+
+	/**
+	 * Request the character to remove a modifier. The request is processed on the next update of the CharacterMovementComponent.
+	 * @param ModifierType The type of modifier to remove, e.g. Modifier.Boost
+	 * @param Level The level of the modifier to remove.
+	 * @param NetType How the modifier is applied, ServerInitiated modifiers can only be removed by the server.
+	 * @param bRemoveAll If true, removes all modifiers of the specified level, otherwise only removes the first one found.
+	 * @return True if the modifier was removed.
+	 */
+	UFUNCTION(BlueprintCallable, Category=Character)
+	virtual bool RemoveModifier(FGameplayTag ModifierType, FGameplayTag Level, EModifierNetType NetType, bool bRemoveAll=false);
+
+	/**
+	 * Server only: add a ServerInitiated modifier that is removed after Duration seconds of movement time
+	 * Client and server both remove it at the same move, so expiring doesn't cause a correction
+	 * @param ModifierType The type of modifier to add, e.g. Modifier.Snare
+	 * @param Level The level of the modifier to add.
+	 * @param Duration How long the modifier lasts, @see UModifierMovement::GetModifierExpiryTimestamp
+	 * @return True if the modifier was added.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Character)
+	virtual bool AddTimedModifier(FGameplayTag ModifierType, FGameplayTag Level, float Duration);
+
+	/**
+	 * Remove every modifier of the type and NetType.
+	 * @return True if any modifiers were removed, false if none were found.
+	 */
+	UFUNCTION(BlueprintCallable, Category=Character)
+	virtual bool ResetModifiers(FGameplayTag ModifierType, EModifierNetType NetType);
+
+protected:
+	/** @return The modifier to change for the request, or nullptr if we're not allowed to change it */
+	FMovementModifier* GetModifierForRequest(const FGameplayTag& ModifierType, EModifierNetType NetType) const;
+	
+public:
+	/* Boost Implementation */
+	
 	/**
 	 * Request the character to start Boost. The request is processed on the next update of the CharacterMovementComponent.
 	 * @param Level The level of the Boost to remove.
@@ -90,6 +242,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category=Character, meta=(GameplayTagFilter="Modifier.Boost"))
 	virtual bool Boost(FGameplayTag Level, EModifierNetType NetType);
 
+	/**
+	 * Server only: Boost the character for Duration seconds, as a ServerInitiated Boost
+	 * @see AddTimedModifier
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Character, meta=(GameplayTagFilter="Modifier.Boost"))
+	virtual bool BoostFor(FGameplayTag Level, float Duration);
+
 	/**
 	 * Request the character to stop Boost. The request is processed on the next update of the CharacterMovementComponent.
 	 * @param Level The level of the Boost to remove.
@@ -125,14 +284,6 @@ public:
 public:
 	/* Snare Implementation */
 	
-	/** Set by character movement to specify that this Character's Snare level. */
-	UPROPERTY(ReplicatedUsing=OnRep_SimulatedSnare)
-	uint8 SimulatedSnare = NO_MODIFIER;
-
-	/** Handle Snare replicated from server */
-	UFUNCTION()
-	virtual void OnRep_SimulatedSnare(uint8 PrevLevel);
-
 	/**
 	 * Request the character to start Modified. The request is processed on the next update of the CharacterMovementComponent.
 	 * @see OnStartModifier
@@ -142,6 +293,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category=Character, meta=(GameplayTagFilter="Modifier.Snare"))
 	virtual bool Snare(FGameplayTag Level);
 
+	/**
+	 * Server only: Snare the character for Duration seconds, without a timer to UnSnare
+	 * @see AddTimedModifier
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Character, meta=(GameplayTagFilter="Modifier.Snare"))
+	virtual bool SnareFor(FGameplayTag Level, float Duration);
+
 	/**
 	 * Request the character to stop Modified. The request is processed on the next update of the CharacterMovementComponent.
 	 * @see OnEndModifier
@@ -177,14 +335,6 @@ public:
 public:
 	/* SlowFall Implementation */
 	
-	/** Set by character movement to specify that this Character's SlowFall level. */
-	UPROPERTY(ReplicatedUsing=OnRep_SimulatedSlowFall)
-	uint8 SimulatedSlowFall = NO_MODIFIER;
-
-	/** Handle SlowFall replicated from server */
-	UFUNCTION()
-	virtual void OnRep_SimulatedSlowFall(uint8 PrevLevel);
-
 	/**
 	 * Request the character to start SlowFall. The request is processed on the next update of the CharacterMovementComponent.
 	 * @param Level The level of the SlowFall to remove.
@@ -0,0 +1,132 @@
+// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "ModifierImpl.h"
+#include "ModifierTypes.h"
+#include "Engine/DataAsset.h"
+#include "ModifierDataAsset.generated.h"
+
+/**
+ * Modifier definitions shared between every UModifierMovement that references this asset
+ * The level tables are built once per asset instead of once per character
+ * Levels assigned on the movement component itself are layered on top of these as an override
+ */
+UCLASS(BlueprintType)
+class PREDICTEDMOVEMENT_API UModifierDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Boost modifies movement properties such as speed and acceleration
+	 * Scaling applied on a per-Boost-level basis
+	 */
+	UPROPERTY(Category=Boost, EditAnywhere, BlueprintReadOnly)
+	TMap<FGameplayTag, FMovementModifierParams> Boost;
+
+	/**
+	 * Limits the maximum number of Boost levels that can be applied to the character
+	 * @see UModifierMovement::bLimitMaxBoosts
+	 */
+	UPROPERTY(Category=Boost, EditAnywhere, BlueprintReadOnly, meta=(InlineEditConditionToggle))
+	bool bLimitMaxBoosts = true;
+
+	/**
+	 * Maximum number of Boost levels that can be applied to the character
+	 * @see UModifierMovement::MaxBoosts
+	 */
+	UPROPERTY(Category=Boost, EditAnywhere, BlueprintReadOnly, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxBoosts"))
+	int32 MaxBoosts = 8;
+
+	/** The method used to calculate Boost levels */
+	UPROPERTY(Category=Boost, EditAnywhere, BlueprintReadOnly)
+	EModifierLevelMethod BoostLevelMethod;
+
+public:
+	/**
+	 * Snare modifies movement properties such as speed and acceleration
+	 * Scaling applied on a per-Snare-level basis
+	 */
+	UPROPERTY(Category=Snare, EditAnywhere, BlueprintReadOnly)
+	TMap<FGameplayTag, FMovementModifierParams> Snare;
+
+	/**
+	 * Limits the maximum number of Snare levels that can be applied to the character
+	 * @see UModifierMovement::bLimitMaxSnares
+	 */
+	UPROPERTY(Category=Snare, EditAnywhere, BlueprintReadOnly, meta=(InlineEditConditionToggle))
+	bool bLimitMaxSnares = true;
+
+	/**
+	 * Maximum number of Snare levels that can be applied to the character
+	 * @see UModifierMovement::MaxSnares
+	 */
+	UPROPERTY(Category=Snare, EditAnywhere, BlueprintReadOnly, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxSnares"))
+	int32 MaxSnares = 8;
+
+	/** The method used to calculate Snare levels */
+	UPROPERTY(Category=Snare, EditAnywhere, BlueprintReadOnly)
+	EModifierLevelMethod SnareLevelMethod;
+
+public:
+	/**
+	 * SlowFall changes falling properties, such as gravity and air control
+	 * Scaling applied on a per-SlowFall-level basis
+	 */
+	UPROPERTY(Category=SlowFall, EditAnywhere, BlueprintReadOnly)
+	TMap<FGameplayTag, FFallingModifierParams> SlowFall;
+
+	/**
+	 * Limits the maximum number of SlowFall levels that can be applied to the character
+	 * @see UModifierMovement::bLimitMaxSlowFalls
+	 */
+	UPROPERTY(Category=SlowFall, EditAnywhere, BlueprintReadOnly, meta=(InlineEditConditionToggle))
+	bool bLimitMaxSlowFalls = true;
+
+	/**
+	 * Maximum number of SlowFall levels that can be applied to the character
+	 * @see UModifierMovement::MaxSlowFalls
+	 */
+	UPROPERTY(Category=SlowFall, EditAnywhere, BlueprintReadOnly, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxSlowFalls"))
+	int32 MaxSlowFalls = 8;
+
+	/** The method used to calculate SlowFall levels */
+	UPROPERTY(Category=SlowFall, EditAnywhere, BlueprintReadOnly)
+	EModifierLevelMethod SlowFallLevelMethod;
+
+public:
+	/** Client auth parameters mapped to a source gameplay tag */
+	UPROPERTY(Category=ClientAuth, EditAnywhere, BlueprintReadOnly)
+	TMap<FGameplayTag, FClientAuthParams> ClientAuthParams;
+
+protected:
+	/** Indexed levels built from Boost, Snare and SlowFall, shared by every component using this asset */
+	TModifierLevelTable<FMovementModifierParams> BoostLevels;
+	TModifierLevelTable<FMovementModifierParams> SnareLevels;
+	TModifierLevelTable<FFallingModifierParams> SlowFallLevels;
+
+public:
+	UModifierDataAsset(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/**
+	 * Build the level tables from Boost, Snare and SlowFall
+	 * Components referencing this asset must rebuild their own tables afterwards
+	 */
+	void BuildModifierLevelTables();
+
+	const TModifierLevelTable<FMovementModifierParams>& GetBoostLevels() const { return BoostLevels; }
+	const TModifierLevelTable<FMovementModifierParams>& GetSnareLevels() const { return SnareLevels; }
+	const TModifierLevelTable<FFallingModifierParams>& GetSlowFallLevels() const { return SlowFallLevels; }
+
+	const FClientAuthParams* GetClientAuthParamsForSource(const FGameplayTag& Source) const { return ClientAuthParams.Find(Source); }
+};
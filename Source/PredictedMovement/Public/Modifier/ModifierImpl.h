@@ -5,10 +5,137 @@
 #include "CoreMinimal.h"
 #include "GameplayTagContainer.h"
 #include "ModifierTypes.h"
+#include "Algo/Sort.h"
+#include "Misc/Crc.h"
 
 // UINT8_MAX is NO_MODIFIER, so UINT8_MAX-1 is the max for uint8 -- NO_MODIFIER is defined in ModifierTypes.h
 using TModSize = uint8;  // If you want more than 254 modifiers, change this to uint16 or uint32
-using TModifierStack = TArray<TModSize>;
+
+// Compile-time upper bound for every modifier stack -- MaxBoosts, MaxSnares and MaxSlowFalls are clamped to this
+#define MAX_MODIFIER_STACK_SIZE 32
+
+static_assert(MAX_MODIFIER_STACK_SIZE < NO_MODIFIER, "MAX_MODIFIER_STACK_SIZE must be representable by TModSize");
+
+/**
+ * Stacks are copied into every saved move, move data and move response, so they use inline storage
+ * This keeps the saved move and net paths free of heap allocations
+ */
+using TModifierStack = TArray<TModSize, TFixedAllocator<MAX_MODIFIER_STACK_SIZE>>;
+
+/**
+ * A timed entry of a modifier stack, removed once the movement timestamp reaches Timestamp
+ * @see UModifierMovement::GetModifierTimestamp
+ */
+struct FModifierExpiry
+{
+	TModSize Level = NO_MODIFIER;
+	float Timestamp = 0.f;
+
+	bool operator==(const FModifierExpiry& Other) const { return Level == Other.Level && Timestamp == Other.Timestamp; }
+};
+
+// Timed entries are copied with every modifier, so far fewer are allowed than MAX_MODIFIER_STACK_SIZE
+#define MAX_TIMED_MODIFIERS 8
+
+using TModifierExpiries = TArray<FModifierExpiry, TFixedAllocator<MAX_TIMED_MODIFIERS>>;
+
+/**
+ * Immutable tag <-> index table for the levels of a modifier type, e.g. Boost
+ * Level indices are sent over the network, so levels are sorted by tag name instead of relying on TMap iteration order
+ * Built once from the params map, then every lookup is O(1)
+ * This is the params-agnostic part of TModifierLevelTable, used by FModifierFamily
+ */
+struct FModifierLevelTableBase
+{
+	/** Level tags, indexed by level */
+	TArray<FGameplayTag> Levels;
+
+	/** Level index for each tag */
+	TMap<FGameplayTag, TModSize> Indices;
+
+	int32 Num() const { return Levels.Num(); }
+
+	/** @return The level tag at Index, or an empty tag if Index is not a valid level */
+	FGameplayTag GetLevel(TModSize Index) const { return Levels.IsValidIndex(Index) ? Levels[Index] : FGameplayTag::EmptyTag; }
+
+	/** @return The index of the Level tag, or NO_MODIFIER if it is not a level of this table */
+	TModSize GetIndex(const FGameplayTag& Level) const
+	{
+		const TModSize* Index = Indices.Find(Level);
+		return Index ? *Index : NO_MODIFIER;
+	}
+
+	/** Accumulate a checksum of the level order, client and server must agree on it for level indices to be meaningful */
+	uint32 GetChecksum(uint32 Crc) const
+	{
+		const int32 NumLevels = Levels.Num();
+		Crc = FCrc::MemCrc32(&NumLevels, sizeof(NumLevels), Crc);
+		for (const FGameplayTag& Level : Levels)
+		{
+			// Tag names are case-insensitive
+			Crc = FCrc::StrCrc32(*Level.ToString().ToLower(), Crc);
+		}
+		return Crc;
+	}
+};
+
+/**
+ * Called on each level's params when a level table is built
+ * Overload this for params that precompute anything, e.g. FFallingModifierParams
+ */
+template<typename TParams>
+void PostBuildModifierLevelParams(TParams& Params)
+{}
+
+/**
+ * Level table with the params for each level
+ * @see FModifierLevelTableBase
+ */
+template<typename TParams>
+struct TModifierLevelTable : FModifierLevelTableBase
+{
+	/** Params for each level, parallel to Levels */
+	TArray<TParams> Params;
+
+	/** Rebuild the table from the params map */
+	void Build(const TMap<FGameplayTag, TParams>& Source)
+	{
+		Levels.Reset();
+		Params.Reset();
+		Indices.Reset();
+
+		for (const TPair<FGameplayTag, TParams>& Level : Source)
+		{
+			if (Level.Key.IsValid())
+			{
+				Levels.Add(Level.Key);
+			}
+		}
+
+		// Stable order that doesn't depend on how the map was populated
+		Algo::Sort(Levels, [](const FGameplayTag& A, const FGameplayTag& B)
+		{
+			return A.GetTagName().Compare(B.GetTagName()) < 0;
+		});
+
+		// NO_MODIFIER is reserved
+		if (!ensureMsgf(Levels.Num() < NO_MODIFIER, TEXT("Too many modifier levels (%d), the maximum is %d"), Levels.Num(), NO_MODIFIER - 1))
+		{
+			Levels.SetNum(NO_MODIFIER - 1);
+		}
+
+		Params.Reserve(Levels.Num());
+		Indices.Reserve(Levels.Num());
+		for (int32 i = 0; i < Levels.Num(); ++i)
+		{
+			PostBuildModifierLevelParams(Params.Add_GetRef(Source.FindChecked(Levels[i])));
+			Indices.Add(Levels[i], static_cast<TModSize>(i));
+		}
+	}
+
+	/** @return The params for the level at Index, or nullptr if Index is not a valid level */
+	const TParams* GetParams(TModSize Index) const { return Params.IsValidIndex(Index) ? &Params[Index] : nullptr; }
+};
 
 /**
  * FSavedMove_Character
@@ -24,7 +151,7 @@ struct PREDICTEDMOVEMENT_API FModifierSavedMove
 
 	virtual void Clear()
 	{
-		WantsModifiers.Empty();
+		WantsModifiers.Reset();
 	}
 
 	void SetMoveFor(const TModifierStack& Modifiers)
@@ -63,7 +190,7 @@ struct PREDICTEDMOVEMENT_API FModifierSavedMove_WithCorrection final : FModifier
 	virtual void Clear() override
 	{
 		Super::Clear();
-		Modifiers.Empty();
+		Modifiers.Reset();
 	}
 
 	void PostUpdate(const TModifierStack& InModifiers)
@@ -84,7 +211,7 @@ struct PREDICTEDMOVEMENT_API FModifierSavedMove_ServerInitiated
 
 	void Clear()
 	{
-		Modifiers.Empty();
+		Modifiers.Reset();
 	}
 
 	void PostUpdate(const TModifierStack& InModifiers)
@@ -178,18 +305,41 @@ struct PREDICTEDMOVEMENT_API FMovementModifier
 	
 	/** The actual state, which represents the actual modifiers applied to the character */
 	TModifierStack Modifiers;
+
+	/** Timed entries of WantsModifiers, never more of a level than WantsModifiers has */
+	TModifierExpiries Expiries;
 	
 	/**
 	 * Adds a modifier to the stack
 	 * @param Level The level of the modifier to add
-	 * @return True if the modifier was added
+	 * @return True if the modifier was added, false if the stack is already at MAX_MODIFIER_STACK_SIZE
 	 */
 	bool AddModifier(TModSize Level)
 	{
+		if (WantsModifiers.Num() >= MAX_MODIFIER_STACK_SIZE)
+		{
+			return false;
+		}
 		WantsModifiers.Add(Level);
 		return true;
 	}
 
+	/**
+	 * Adds a modifier to the stack that is removed once the movement timestamp reaches ExpiryTimestamp
+	 * @param Level The level of the modifier to add
+	 * @param ExpiryTimestamp When to remove it, on the timeline of UModifierMovement::GetModifierTimestamp
+	 * @return True if the modifier was added, false if the stack is already at MAX_MODIFIER_STACK_SIZE or MAX_TIMED_MODIFIERS
+	 */
+	bool AddTimedModifier(TModSize Level, float ExpiryTimestamp)
+	{
+		if (Expiries.Num() >= MAX_TIMED_MODIFIERS || !AddModifier(Level))
+		{
+			return false;
+		}
+		Expiries.Add({ Level, ExpiryTimestamp });
+		return true;
+	}
+
 	/**
 	 * Removes a modifier from the stack
 	 * @param Level The level of the modifier to remove
@@ -208,17 +358,37 @@ struct PREDICTEDMOVEMENT_API FMovementModifier
 			{
 				WantsModifiers.RemoveSingle(Level);
 			}
+			TrimExpiries();
 			return true;
 		}
 		return false;
 	}
 
+	/**
+	 * Removes every timed modifier that expired at Timestamp
+	 * @return True if any modifiers were removed
+	 */
+	bool ExpireModifiers(float Timestamp);
+
+	/** Removes the latest expiries of any level that now has more expiries than WantsModifiers entries */
+	void TrimExpiries();
+
+	/** Shift every expiry, e.g. when the movement timestamp is reset */
+	void RebaseExpiries(float Offset)
+	{
+		for (FModifierExpiry& Expiry : Expiries)
+		{
+			Expiry.Timestamp += Offset;
+		}
+	}
+
 	/**
 	 * Removes all modifiers from the stack
 	 * @return True if any modifiers were removed, false otherwise
 	 */
 	bool ResetModifiers()
 	{
+		Expiries.Reset();
 		if (WantsModifiers.Num() > 0)
 		{
 			WantsModifiers.Reset();
@@ -297,6 +467,45 @@ struct PREDICTEDMOVEMENT_API FMovementModifier_WithCorrection final : FMovementM
 	}
 };
 
+/**
+ * The inputs a modifier family was last processed with, e.g. BoostLocal, BoostCorrection and BoostServer
+ * If none of these have changed, processing the family again would produce the same state and can be skipped
+ */
+struct PREDICTEDMOVEMENT_API FModifierProcessCache
+{
+	/** WantsModifiers of each modifier in the family */
+	TArray<TModifierStack, TInlineAllocator<3>> WantsModifiers;
+
+	TModSize Level = NO_MODIFIER;
+	int32 MaxModifiers = 0;
+	int32 NumLevels = 0;
+	EModifierLevelMethod Method = EModifierLevelMethod::Max;
+	bool bLimitMaxModifiers = false;
+	bool bAllowedInCurrentState = false;
+	bool bValid = false;
+
+	/** Force the family to be processed next time */
+	void Invalidate() { bValid = false; }
+
+	bool IsUpToDate(TModSize CurrentLevel, EModifierLevelMethod InMethod, int32 InNumLevels, bool bInLimitMaxModifiers,
+		int32 InMaxModifiers, bool bInAllowedInCurrentState, TArrayView<FMovementModifier* const> Modifiers) const;
+
+	void Update(TModSize CurrentLevel, EModifierLevelMethod InMethod, int32 InNumLevels, bool bInLimitMaxModifiers,
+		int32 InMaxModifiers, bool bInAllowedInCurrentState, TArrayView<FMovementModifier* const> Modifiers);
+};
+
+/**
+ * Every reduction of a modifier stack, computed in a single pass
+ * @see FModifierStatics::ReduceModifierLevels
+ */
+struct FModifierLevelReduction
+{
+	uint32 Sum = 0;
+	int32 Num = 0;
+	TModSize Max = 0;
+	TModSize Min = 0;
+};
+
 /**
  * Static functions for modifiers
  */
@@ -312,6 +521,34 @@ struct PREDICTEDMOVEMENT_API FModifierStatics
 	 */
 	static bool NetSerialize(TModifierStack& Modifiers, FArchive& Ar, const FString& ErrorName, uint8 MaxSerializedModifiers=8);
 
+	/**
+	 * Bit-packs a non-empty modifier stack to the archive, presence must be signalled separately by the caller
+	 * The count is packed to ceil(log2(MaxSerializedModifiers)) bits and each level to ceil(log2(NumLevels)) bits
+	 * @param Modifiers The modifier stack to serialize
+	 * @param Ar The archive to serialize to
+	 * @param ErrorName The name of the Modifier to report if serialization fails
+	 * @param NumLevels The number of levels available to the modifier, this must match between client and server
+	 * @param MaxSerializedModifiers The maximum number of modifiers to serialize (default is 8)
+	 * @return True if serialization was successful, false otherwise
+	 */
+	static bool NetSerializePacked(TModifierStack& Modifiers, FArchive& Ar, const TCHAR* ErrorName, int32 NumLevels, uint8 MaxSerializedModifiers=8);
+
+	/**
+	 * Serializes Value using the minimum number of bits required to represent [0, ValueMax)
+	 * Nothing is serialized when ValueMax is 1 or less, because the value can only be 0
+	 */
+	static void SerializeBounded(FArchive& Ar, uint32& Value, uint32 ValueMax);
+
+	/** Hash of every modifier's WantsModifiers and Modifiers, to tell whether a family is still in a resolved state */
+	static uint64 HashModifiers(TArrayView<FMovementModifier* const> Modifiers);
+
+	/**
+	 * Serializes timed modifier entries, a single bit if there are none
+	 * Levels are packed to ceil(log2(NumLevels)) bits, timestamps are sent at full precision because client and
+	 * server must compare them against the same move timestamps
+	 */
+	static void NetSerializeExpiries(TModifierExpiries& Expiries, FArchive& Ar, int32 NumLevels);
+
 	/**
 	 * Updates the modifier level based on the specified method
 	 * @param Method The method to use for updating the modifier level
@@ -322,6 +559,28 @@ struct PREDICTEDMOVEMENT_API FModifierStatics
 	 */
 	static TModSize UpdateModifierLevel(EModifierLevelMethod Method, const TModifierStack& Modifiers, TModSize MaxLevel, TModSize InvalidLevel);
 
+	/**
+	 * Updates the level of each stack of a single family, e.g. its LocalPredicted, WithCorrection and ServerInitiated stacks
+	 * This loops over UpdateModifierLevel, only the reduction of each stack is vectorized
+	 * @param Method The method to use for updating the modifier levels
+	 * @param Stacks The stacks of modifiers to update
+	 * @param MaxLevel The maximum level of modifiers
+	 * @param InvalidLevel The level to output for stacks without valid modifiers
+	 * @param OutLevels The level of each stack, must be the same size as Stacks
+	 */
+	static void UpdateModifierLevels(EModifierLevelMethod Method, TArrayView<const TModifierStack* const> Stacks,
+		TModSize MaxLevel, TModSize InvalidLevel, TArrayView<TModSize> OutLevels);
+
+	/**
+	 * Computes the max, min, sum and count of a modifier stack in one pass
+	 * Uses SIMD where available, the whole inline storage of the stack is read and the unused entries are masked out
+	 */
+	static FModifierLevelReduction ReduceModifierLevels(const TModifierStack& Modifiers);
+
+	/** Select the level Method results in from a reduction, without branching on Method */
+	static TModSize ResolveModifierLevel(EModifierLevelMethod Method, const FModifierLevelReduction& Reduction,
+		TModSize MaxLevel, TModSize InvalidLevel);
+
 	/**
 	 * Combines multiple modifier levels into a single level based on the specified method
 	 * @param Method The method to use for combining the modifier levels
@@ -340,11 +599,12 @@ struct PREDICTEDMOVEMENT_API FModifierStatics
 	 * @param bLimitMaxModifiers Whether to limit the maximum number of modifiers
 	 * @param MaxModifiers The maximum number of modifiers allowed
 	 * @param InvalidLevel The level to return if no valid modifiers are found
-	 * @param Modifiers The array of modifiers to process
-	 * @param CanActivateCallback Callback to determine if the modifier can be activated
+	 * @param Modifiers The modifiers to process
+	 * @param CanActivateCallback Callback to determine if the modifier can be activated, called once for the family
+	 * @param Cache Optional, if nothing changed since the family was last processed with this cache, processing is skipped
 	 * @return True if the current level changed, false otherwise
 	 */
 	static bool ProcessModifiers(TModSize& CurrentLevel, EModifierLevelMethod Method, const TArray<FGameplayTag>& LevelTags,
-		bool bLimitMaxModifiers, int32 MaxModifiers, TModSize InvalidLevel,	const TArray<FMovementModifier*>& Modifiers,
-		const TFunctionRef<bool()>& CanActivateCallback);
+		bool bLimitMaxModifiers, int32 MaxModifiers, TModSize InvalidLevel, TArrayView<FMovementModifier* const> Modifiers,
+		const TFunctionRef<bool()>& CanActivateCallback, FModifierProcessCache* Cache = nullptr);
 };
\ No newline at end of file
@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GameplayTagContainer.h"
+#include "ModifierDataAsset.h"
 #include "ModifierImpl.h"
+#include "ModifierRegistry.h"
+#include "ModifierTags.h"
 #include "ModifierTypes.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "System/PredictedMovementVersioning.h"
+#include "System/PredictedSavedMovePool.h"
 #include "ModifierMovement.generated.h"
 
 class AModifierCharacter;
@@ -24,15 +28,26 @@ struct PREDICTEDMOVEMENT_API FModifierMoveResponseDataContainer : FCharacterMove
 	 * Used by the server to send Modifier data to the client
 	 * LocalPredicted modifiers are not sent, as the server does not correct input states
 	 */
-	
-	FModifierMoveResponse BoostCorrection;
-	FModifierMoveResponse BoostServer;
-	FModifierMoveResponse SnareServer;
 
-	/** Tell the client how much location authority they have */
+	/** Modifiers of every corrected slot, indexed by FModifierSlot::ModifiersIndex */
+	TArray<TModifierStack, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Modifiers;
+
+	/** Timed entries of every corrected slot, so the client expires them at the same move as the server */
+	TArray<TModifierExpiries, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Expiries;
+
+	/** Every corrected slot, one bit each */
+	static constexpr uint32 Mask_All = MAX_uint32;
+
+	/**
+	 * Corrected slots that differ from what the client reported, one bit per FModifierSlot::ModifiersIndex
+	 * Only these are sent, the client restores the others from the move it reported them in
+	 */
+	uint32 ModifierMask = Mask_All;
+
+	/** Tell the client how much location authority they have -- Quantized to 8 bits when sent */
 	float ClientAuthAlpha = 0.f;
 
-	/** No need to send the float if the client has no authority */
+	/** No need to send the alpha if the client has no authority */
 	bool bHasClientAuthAlpha;
 
 	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
@@ -52,12 +67,9 @@ public:
 	 * If local predicted, this data is based on player input, and the server will apply it
 	 * Otherwise, the server will compare the client and server data to know when to send a correction
 	 */
-	
-	FModifierMoveData_LocalPredicted BoostLocal;
-	FModifierMoveData_WithCorrection BoostCorrection;
-	FModifierMoveData_ServerInitiated BoostServer;
-	FModifierMoveData_ServerInitiated SnareServer;
-	FModifierMoveData_LocalPredicted SlowFallLocal;
+
+	/** Stacks of every modifier slot, laid out by UModifierMovement::GetModifierRegistry() */
+	FModifierStacks Stacks;
 	
 	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
 	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
@@ -79,9 +91,139 @@ private:
 	FModifierNetworkMoveData MoveData[3];
 };
 
+/**
+ * A server move container received while p.Modifier.BatchServerMoves is enabled
+ * Performed later in the frame by UModifierMovementSubsystem
+ */
+struct PREDICTEDMOVEMENT_API FModifierQueuedServerMoves
+{
+	FModifierNetworkMoveData NewMove;
+	FModifierNetworkMoveData PendingMove;
+	FModifierNetworkMoveData OldMove;
+
+	bool bIsDualMove = false;
+	bool bIsDualHybridRootMotionMove = false;
+	bool bHasPendingMove = false;
+	bool bHasOldMove = false;
+	bool bDisableCombinedScopedMove = false;
+};
+
+/**
+ * A modifier family resolved ahead of a queued server move, or by a saved move for its replay
+ * Adopted when the move is performed if the family's inputs are unchanged, otherwise it is processed as usual
+ * Saved moves keep one per family and pass, so only the stacks of families that changed are stored
+ */
+struct PREDICTEDMOVEMENT_API FModifierResolvedFamily
+{
+	/** The family's modifiers after applying the move's WantsModifiers, @see FModifierStatics::HashModifiers */
+	uint64 InHash = 0;
+	TModSize InLevel = NO_MODIFIER;
+
+	/** Snapshot of CanActivate, if the state differs when the move is performed this is discarded */
+	bool bAllowedInCurrentState = false;
+
+	/** First of the family's resulting stacks in FModifierResolvedMove::OutModifiers, INDEX_NONE if they didn't change */
+	int16 OutModifiersIndex = INDEX_NONE;
+	TModSize OutLevel = NO_MODIFIER;
+	bool bChanged = false;
+
+	bool bValid = false;
+};
+
+/** Every modifier family resolved ahead of a queued server move, or by a saved move for its replay */
+struct PREDICTEDMOVEMENT_API FModifierResolvedMove
+{
+	/** The queued move this was resolved from, matched by timestamp when it is performed */
+	const FModifierNetworkMoveData* MoveData = nullptr;
+	float TimeStamp = 0.f;
+
+	/** UModifierMovement::ModifierProcessRevision it was resolved with, the settings may have changed since */
+	uint32 Revision = 0;
+
+	TArray<FModifierResolvedFamily, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Families;
+
+	/** Resulting stacks of the families that changed, one per slot, inline so saved moves don't allocate */
+	TArray<TModifierStack, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> OutModifiers;
+
+	void Reset()
+	{
+		Families.Reset();
+		OutModifiers.Reset();
+	}
+
+	/** Keep the resulting stacks of a family that changed */
+	void SetOutModifiers(FModifierResolvedFamily& Family, TArrayView<FMovementModifier* const> Modifiers)
+	{
+		Family.OutModifiersIndex = static_cast<int16>(OutModifiers.Num());
+		for (const FMovementModifier* Modifier : Modifiers)
+		{
+			OutModifiers.Add(Modifier->Modifiers);
+		}
+	}
+};
+
+/** ProcessModifierMovementState() runs before and after movement, each is resolved separately */
+enum class EModifierResolvePass : uint8
+{
+	BeforeMovement,
+	AfterMovement,
+	Num
+};
+
+/**
+ * Modifier params combined across every active modifier
+ * Resolved only when a modifier level changes, so the movement getters never look up the params maps on the hot path
+ */
+struct PREDICTEDMOVEMENT_API FModifierEffectiveParams
+{
+	float SpeedScalar = 1.f;
+	float AccelScalar = 1.f;
+	float BrakingScalar = 1.f;
+	float GroundFrictionScalar = 1.f;
+	float BrakingFrictionScalar = 1.f;
+	float RootMotionScalar = 1.f;
+
+	/** Copy of the active SlowFall params, only valid if bSlowFall is true */
+	FFallingModifierParams SlowFall;
+	bool bSlowFall = false;
+
+	/** The level of every registered family these params were resolved from, indexed by family */
+	TArray<TModSize, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> FamilyLevels;
+	bool bResolved = false;
+
+	/** Copy the current level of every family in Registry */
+	void SetResolvedFor(const FModifierRegistry& Registry)
+	{
+		FamilyLevels.SetNumUninitialized(Registry.Families.Num(), EAllowShrinking::No);
+		for (int32 i = 0; i < Registry.Families.Num(); i++)
+		{
+			FamilyLevels[i] = *Registry.Families[i].Level;
+		}
+		bResolved = true;
+	}
+
+	/** @return True if no family in Registry changed level since these params were resolved */
+	bool IsResolvedFor(const FModifierRegistry& Registry) const
+	{
+		if (!bResolved || FamilyLevels.Num() != Registry.Families.Num())
+		{
+			return false;
+		}
+		for (int32 i = 0; i < Registry.Families.Num(); i++)
+		{
+			if (FamilyLevels[i] != *Registry.Families[i].Level)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
 /**
  * Supports stackable modifiers such as Boost, Snare, and SlowFall.
- * Duplicate the implementations to add your own modifiers. Don't forget to do the same for the character class.
+ * Register your own modifier families with ModifierRegistry.AddFamily() to add your own modifiers, the saved move,
+ * move data, corrections and simulated proxy replication handle every registered family.
  */
 UCLASS()
 class PREDICTEDMOVEMENT_API UModifierMovement : public UCharacterMovementComponent
@@ -93,10 +235,20 @@ private:
 	UPROPERTY(Transient, DuplicateTransient)
 	TObjectPtr<AModifierCharacter> ModifierCharacterOwner;
 
+public:
+	/**
+	 * Shared modifier definitions, many components can reference the same asset to share their level tables
+	 * When assigned, the asset's level methods and limits are used instead of the ones on this component
+	 * If not assigned, the UModifierDataAsset defaults are used for any modifier without levels on this component
+	 */
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<UModifierDataAsset> ModifierData;
+
 public:
 	/**
 	 * Boost modifies movement properties such as speed and acceleration
 	 * Scaling applied on a per-Boost-level basis
+	 * Optional override, these levels are added to (or replace) the levels from ModifierData for this component only
 	 */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	TMap<FGameplayTag, FMovementModifierParams> Boost;
@@ -116,13 +268,9 @@ public:
 	 * It limits both the number being serialized and sent over the network, as well as having gameplay implications
 	 * Priority is granted in order, because modifiers consume the remaining slots, so LocalPredicted -> WithCorrection - ServerInitiated
 	 */
-	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, UIMin=1, UIMax=32, EditCondition="bLimitMaxBoosts"))
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxBoosts"))
 	int32 MaxBoosts = 8;
 
-	/** Indexed list of Boost levels, used to determine the current Boost level based on index */
-	UPROPERTY()
-	TArray<FGameplayTag> BoostLevels;
-
 	/** The method used to calculate Boost levels */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	EModifierLevelMethod BoostLevelMethod;
@@ -140,6 +288,7 @@ public:
 	/**
 	 * Snare modifies movement properties such as speed and acceleration
 	 * Scaling applied on a per-Snare-level basis
+	 * Optional override, these levels are added to (or replace) the levels from ModifierData for this component only
 	 */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	TMap<FGameplayTag, FMovementModifierParams> Snare;
@@ -157,13 +306,9 @@ public:
 	 * This value is shared between each type of Snare
 	 * It limits both the number being serialized and sent over the network, as well as having gameplay implications
 	 */
-	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, UIMin=1, UIMax=32, EditCondition="bLimitMaxSnares"))
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxSnares"))
 	int32 MaxSnares = 8;
 
-	/** Indexed list of Snare levels, used to determine the current Snare level based on index */
-	UPROPERTY()
-	TArray<FGameplayTag> SnareLevels;
-
 	/** The method used to calculate Snare levels */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	EModifierLevelMethod SnareLevelMethod;
@@ -175,6 +320,7 @@ public:
 	/**
 	 * SlowFall changes falling properties, such as gravity and air control
 	 * Scaling applied on a per-SlowFall-level basis
+	 * Optional override, these levels are added to (or replace) the levels from ModifierData for this component only
 	 */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	TMap<FGameplayTag, FFallingModifierParams> SlowFall;
@@ -194,13 +340,9 @@ public:
 	 * It limits both the number being serialized and sent over the network, as well as having gameplay implications
 	 * Priority is granted in order, because modifiers consume the remaining slots, so LocalPredicted -> WithCorrection - ServerInitiated
 	 */
-	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, UIMin=1, UIMax=32, EditCondition="bLimitMaxSlowFalls"))
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, ClampMax=32, UIMin=1, UIMax=32, EditCondition="bLimitMaxSlowFalls"))
 	int32 MaxSlowFalls = 8;
 
-	/** Indexed list of SlowFall levels, used to determine the current SlowFall level */
-	UPROPERTY()
-	TArray<FGameplayTag> SlowFallLevels;
-
 	/** The method used to calculate SlowFall levels */
 	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite)
 	EModifierLevelMethod SlowFallLevelMethod;
@@ -209,26 +351,261 @@ public:
 	TMod_Local SlowFallLocal;
 	
 public:
-	/** Client auth parameters mapped to a source gameplay tag */
+	/**
+	 * Client auth parameters mapped to a source gameplay tag
+	 * Optional override, sources not found here are taken from ModifierData
+	 */
 	UPROPERTY(Category="Character Movement (Networking)", EditAnywhere, BlueprintReadOnly)
 	TMap<FGameplayTag, FClientAuthParams> ClientAuthParams;
 
 	UPROPERTY()
 	FClientAuthStack ClientAuthStack;
 
+	/** Combined params of the highest priority client auth data, reused until ClientAuthStack changes */
+	FClientAuthParams CachedClientAuthParams;
+	uint32 CachedClientAuthRevision = 0;
+	bool bClientAuthParamsCached = false;
+
+	/**
+	 * If true, the server only tests client authority for the new move of each packet received
+	 * instead of every move, the pending move sent with it still spends authority time
+	 * The client's location is only taken from the new move, which is the most recent
+	 */
+	UPROPERTY(Category="Character Movement (Networking)", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	bool bEvaluateClientAuthPerPacket = false;
+
 	UPROPERTY()
 	float ClientAuthAlpha = 0.f;
 
+protected:
+	/** The new move of the packet being handled by ServerMove_HandleMoveData, see bEvaluateClientAuthPerPacket */
+	const FCharacterNetworkMoveData* ClientAuthPacketMoveData = nullptr;
+
+	/** @return True if the move being performed is tested for client authority, see bEvaluateClientAuthPerPacket */
+	bool IsClientAuthEvaluatedForCurrentMove() const
+	{
+		return !bEvaluateClientAuthPerPacket || GetCurrentNetworkMoveData() == ClientAuthPacketMoveData;
+	}
+
+public:
+
 	UPROPERTY()
 	uint64 ClientAuthIdCounter = 0;
+
+	/**
+	 * Server only: the corrected modifier stacks that differ from what the client reported in ServerCheckClientError
+	 * @see FModifierMoveResponseDataContainer::ModifierMask
+	 */
+	uint32 ClientModifierErrorMask = FModifierMoveResponseDataContainer::Mask_All;
+
+public:
+	/**
+	 * If true, a modifier family (e.g. every Boost) is only processed when its WantsModifiers, activation state,
+	 * level or settings changed since it was last processed
+	 * Most characters have no modifier changes on most ticks, this skips all of that work
+	 */
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	bool bSkipUnchangedModifiers = true;
+
+	/**
+	 * How strictly saved moves must match in modifier state to be combined
+	 * Every combined move is one less move sent to the server, see stat PredictedMovement and TRACE_PREDICTED_COMBINE
+	 */
+	UPROPERTY(Category="Character Movement: Modifiers", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	EModifierCombinePolicy ModifierCombinePolicy = EModifierCombinePolicy::Strict;
+
+	/**
+	 * The level a family would resolve to from the predicted WantsModifiers of Stacks
+	 * Slots the client doesn't predict use their current WantsModifiers, the activation state is not considered
+	 */
+	TModSize ResolveWantedFamilyLevel(int32 FamilyIndex, const FModifierStacks& InStacks) const;
+
+protected:
+	/** Server moves received this frame while batching, in the order they were received */
+	TArray<FModifierQueuedServerMoves> QueuedServerMoves;
+
+	/** Modifier families resolved ahead of each queued move, in the order the moves are performed */
+	TArray<FModifierResolvedMove> ResolvedServerMoves;
+
+	/** The state of each family the first queued move starts from, captured by SnapshotQueuedServerMoves */
+	TArray<TArray<FMovementModifier, TInlineAllocator<3>>, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> QueuedStartModifiers;
+
+	/** The resolved move for the move currently being performed, if any */
+	FModifierResolvedMove* CurrentResolvedMove = nullptr;
+	int32 NextResolvedMove = 0;
+
+	/** Queued moves are copied back into this to be performed */
+	FModifierNetworkMoveDataContainer QueuedMoveDataContainer;
+	bool bPerformingQueuedServerMoves = false;
+
+	/** Adopt a resolved result for the family, if its inputs are unchanged */
+	bool AdoptResolvedModifiers(const FModifierResolvedMove& Move, const FModifierResolvedFamily& Resolved, int32 FamilyIndex,
+		bool bAllowedInCurrentState, bool& bOutChanged);
+
+	/**
+	 * Each pass of the move being performed for the first time by the autonomous proxy, saved with the move
+	 * When a correction replays the move, any family with the same inputs adopts the result instead of processing again
+	 */
+	FModifierResolvedMove RecordedResolvePasses[static_cast<int32>(EModifierResolvePass::Num)];
+
+	/** The saved move's passes while it is being replayed, @see FSavedMove_Character_Modifier::PrepMoveFor */
+	FModifierResolvedMove* ReplayResolvePasses = nullptr;
+
+	EModifierResolvePass ResolvePass = EModifierResolvePass::BeforeMovement;
+
+	/** Bumped whenever processing is invalidated, so resolved passes saved before are no longer adopted */
+	uint32 ModifierProcessRevision = 0;
+
+	/** @return True if the autonomous proxy is performing a new move, rather than replaying one */
+	bool IsRecordingResolvePasses() const;
+
+public:
+	/** Game thread: capture the modifier state and activation state the queued moves will start from */
+	void SnapshotQueuedServerMoves();
+
+	/** Any thread: resolve the modifier levels of every queued move from the snapshot, touches nothing else */
+	void PreResolveQueuedServerMoves();
+
+	/** Game thread: perform every queued move in order */
+	void PerformQueuedServerMoves();
+
+	bool HasQueuedServerMoves() const { return QueuedServerMoves.Num() > 0; }
+
+	/**
+	 * Queued moves are stored as FModifierNetworkMoveData, which would slice move data of a derived container
+	 * Subclasses that set their own network move data container are not batched and perform their moves as usual
+	 */
+	bool CanBatchServerMoves() const { return &GetNetworkMoveDataContainer() == &ModifierMoveDataContainer; }
+
+	const FModifierResolvedMove* GetRecordedResolvePasses() const { return RecordedResolvePasses; }
+
+	/** Set by the saved move being replayed, nullptr once replaying ends */
+	void SetReplayResolvePasses(FModifierResolvedMove* InPasses) { ReplayResolvePasses = InPasses; }
+
+protected:
+	/** The timestamp of the saved move being replayed, @see FSavedMove_Character_Modifier::PrepMoveFor */
+	float ModifierReplayTimestamp = 0.f;
+
+	/** The timestamp timed modifiers were last expired at, to detect timestamp resets */
+	float LastModifierExpiryTimestamp = 0.f;
+
+	/** Remove timed modifiers that expired by the current move, called before the families are processed */
+	void ExpireTimedModifiers();
+
+public:
+	void SetModifierReplayTimestamp(float InTimestamp) { ModifierReplayTimestamp = InTimestamp; }
+
+	/**
+	 * The timestamp of the move being performed, client and server agree on it for every move
+	 * This is the same timeline as UProneMovement::GetTimestamp, but also correct while the client replays moves
+	 */
+	float GetModifierTimestamp() const;
+
+	/**
+	 * The expiry timestamp for a timed modifier that starts now
+	 * Duration is limited to half of MinTimeBetweenTimeStampResets, so a timestamp reset can always be detected
+	 */
+	float GetModifierExpiryTimestamp(float Duration) const;
+
+protected:
+	/**
+	 * Every modifier family and its slots, registered in the constructor
+	 * Add your own modifier types with ModifierRegistry.AddFamily() in your constructor, then assign their level
+	 * tables with SetLevels() and call UpdateModifierTableChecksum() from your BuildModifierLevelTables() override
+	 */
+	FModifierRegistry ModifierRegistry;
+
+	/** Indices of the built-in families in ModifierRegistry, these match EModifierType */
+	enum EModifierFamily : int32
+	{
+		Family_Boost = static_cast<int32>(EModifierType::Boost),
+		Family_Snare = static_cast<int32>(EModifierType::Snare),
+		Family_SlowFall = static_cast<int32>(EModifierType::SlowFall),
+		Family_Num = static_cast<int32>(EModifierType::Num)
+	};
+
+public:
+	const FModifierRegistry& GetModifierRegistry() const { return ModifierRegistry; }
+
+
+	/** @return The modifier of the family Type with NetType, or nullptr if the family has no such slot */
+	FMovementModifier* FindModifier(const FGameplayTag& Type, EModifierNetType NetType) const;
+	FMovementModifier* FindModifier(int32 FamilyIndex, EModifierNetType NetType) const;
+	FMovementModifier* FindModifier(EModifierType Type, EModifierNetType NetType) const { return FindModifier(static_cast<int32>(Type), NetType); }
+
+	/** @return The index of Level for the family Type, or NO_MODIFIER if either is not found */
+	TModSize GetModifierLevelIndex(const FGameplayTag& Type, const FGameplayTag& Level) const;
+	TModSize GetModifierLevelIndex(int32 FamilyIndex, const FGameplayTag& Level) const;
 	
 public:
 	UModifierMovement(const FObjectInitializer& ObjectInitializer);
 
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	virtual bool HasValidData() const override;
 	virtual void PostLoad() override;
+	virtual void OnRegister() override;
 	virtual void SetUpdatedComponent(USceneComponent* NewUpdatedComponent) override;
 
+public:
+	/**
+	 * Resolve the level tables from ModifierData and the Boost, Snare and SlowFall overrides
+	 * Modifiers without overrides share the asset's tables, only overridden modifiers build their own
+	 * The tables and level settings are then assigned to each family of ModifierRegistry
+	 * Called on load, register and edit, call this after changing the level maps, level settings or ModifierData at runtime
+	 */
+	UFUNCTION(BlueprintCallable, Category="Character Movement: Modifiers")
+	virtual void BuildModifierLevelTables();
+
+	/** The assigned ModifierData, or the default definitions if none is assigned */
+	const UModifierDataAsset* GetModifierData() const { return ModifierData ? ModifierData.Get() : GetDefault<UModifierDataAsset>(); }
+
+	const TModifierLevelTable<FMovementModifierParams>& GetBoostLevels() const { return *BoostLevels; }
+	const TModifierLevelTable<FMovementModifierParams>& GetSnareLevels() const { return *SnareLevels; }
+	const TModifierLevelTable<FFallingModifierParams>& GetSlowFallLevels() const { return *SlowFallLevels; }
+
+	EModifierLevelMethod GetBoostLevelMethod() const { return ModifierData ? ModifierData->BoostLevelMethod : BoostLevelMethod; }
+	bool ShouldLimitMaxBoosts() const { return ModifierData ? ModifierData->bLimitMaxBoosts : bLimitMaxBoosts; }
+	int32 GetMaxBoosts() const { return ModifierData ? ModifierData->MaxBoosts : MaxBoosts; }
+
+	EModifierLevelMethod GetSnareLevelMethod() const { return ModifierData ? ModifierData->SnareLevelMethod : SnareLevelMethod; }
+	bool ShouldLimitMaxSnares() const { return ModifierData ? ModifierData->bLimitMaxSnares : bLimitMaxSnares; }
+	int32 GetMaxSnares() const { return ModifierData ? ModifierData->MaxSnares : MaxSnares; }
+
+	EModifierLevelMethod GetSlowFallLevelMethod() const { return ModifierData ? ModifierData->SlowFallLevelMethod : SlowFallLevelMethod; }
+	bool ShouldLimitMaxSlowFalls() const { return ModifierData ? ModifierData->bLimitMaxSlowFalls : bLimitMaxSlowFalls; }
+	int32 GetMaxSlowFalls() const { return ModifierData ? ModifierData->MaxSlowFalls : MaxSlowFalls; }
+
+protected:
+	/** Level tables in use, these point into the shared ModifierData unless this component overrides the levels */
+	const TModifierLevelTable<FMovementModifierParams>* BoostLevels = nullptr;
+	const TModifierLevelTable<FMovementModifierParams>* SnareLevels = nullptr;
+	const TModifierLevelTable<FFallingModifierParams>* SlowFallLevels = nullptr;
+
+	/** Level tables built only for the modifiers this component overrides */
+	TModifierLevelTable<FMovementModifierParams> LocalBoostLevels;
+	TModifierLevelTable<FMovementModifierParams> LocalSnareLevels;
+	TModifierLevelTable<FFallingModifierParams> LocalSlowFallLevels;
+
+public:
+	/** Checksum of every level table, the server replicates it so clients can detect mismatched level indices */
+	uint32 GetModifierTableChecksum() const { return ModifierTableChecksum; }
+
+	/**
+	 * Compare the server's level table checksum against our own
+	 * Level indices are sent over the network, a mismatch means every modifier would silently de-sync
+	 * @return True if the tables match
+	 */
+	virtual bool VerifyModifierTableChecksum(uint32 ServerChecksum) const;
+
+protected:
+	/** Checksum every family's level table, and invalidate anything resolved from them */
+	void UpdateModifierTableChecksum();
+
+	uint32 ModifierTableChecksum = 0;
+
 public:
 	virtual float GetMaxAcceleration() const override;
 	virtual float GetMaxSpeed() const override;
@@ -248,9 +625,9 @@ public:
 
 	uint8 BoostLevel = NO_MODIFIER;
 	bool IsBoostActive() const { return BoostLevel != NO_MODIFIER; }
-	const FMovementModifierParams* GetBoostParams() const { return Boost.Find(GetBoostLevel()); }
-	FGameplayTag GetBoostLevel() const { return BoostLevels.IsValidIndex(BoostLevel) ? BoostLevels[BoostLevel] : FGameplayTag::EmptyTag; }
-	uint8 GetBoostLevelIndex(const FGameplayTag& Level) const { return BoostLevels.IndexOfByKey(Level) > INDEX_NONE ? BoostLevels.IndexOfByKey(Level) : NO_MODIFIER; }
+	const FMovementModifierParams* GetBoostParams() const { return BoostLevels->GetParams(BoostLevel); }
+	FGameplayTag GetBoostLevel() const { return BoostLevels->GetLevel(BoostLevel); }
+	uint8 GetBoostLevelIndex(const FGameplayTag& Level) const { return BoostLevels->GetIndex(Level); }
 	virtual bool CanBoostInCurrentState() const;
 
 	float GetBoostSpeedScalar() const { return GetBoostParams() ? GetBoostParams()->MaxWalkSpeed : 1.f; }
@@ -267,9 +644,9 @@ public:
 
 	uint8 SnareLevel = NO_MODIFIER;
 	bool IsSnareActive() const { return SnareLevel != NO_MODIFIER; }
-	const FMovementModifierParams* GetSnareParams() const { return Snare.Find(GetSnareLevel()); }
-	FGameplayTag GetSnareLevel() const { return SnareLevels.IsValidIndex(SnareLevel) ? SnareLevels[SnareLevel] : FGameplayTag::EmptyTag; }
-	uint8 GetSnareLevelIndex(const FGameplayTag& Level) const { return SnareLevels.IndexOfByKey(Level) > INDEX_NONE ? SnareLevels.IndexOfByKey(Level) : NO_MODIFIER; }
+	const FMovementModifierParams* GetSnareParams() const { return SnareLevels->GetParams(SnareLevel); }
+	FGameplayTag GetSnareLevel() const { return SnareLevels->GetLevel(SnareLevel); }
+	uint8 GetSnareLevelIndex(const FGameplayTag& Level) const { return SnareLevels->GetIndex(Level); }
 	virtual bool CanSnareInCurrentState() const;
 
 	float GetSnareSpeedScalar() const { return GetSnareParams() ? GetSnareParams()->MaxWalkSpeed : 1.f; }
@@ -286,30 +663,66 @@ public:
 
 	uint8 SlowFallLevel = NO_MODIFIER;
 	bool IsSlowFallActive() const { return SlowFallLevel != NO_MODIFIER; }
-	const FFallingModifierParams* GetSlowFallParams() const { return SlowFall.Find(GetSlowFallLevel()); }
-	FGameplayTag GetSlowFallLevel() const { return SlowFallLevels.IsValidIndex(SlowFallLevel) ? SlowFallLevels[SlowFallLevel] : FGameplayTag::EmptyTag; }
-	uint8 GetSlowFallLevelIndex(const FGameplayTag& Level) const { return SlowFallLevels.IndexOfByKey(Level) > INDEX_NONE ? SlowFallLevels.IndexOfByKey(Level) : NO_MODIFIER; }
+	const FFallingModifierParams* GetSlowFallParams() const { return SlowFallLevels->GetParams(SlowFallLevel); }
+	FGameplayTag GetSlowFallLevel() const { return SlowFallLevels->GetLevel(SlowFallLevel); }
+	uint8 GetSlowFallLevelIndex(const FGameplayTag& Level) const { return SlowFallLevels->GetIndex(Level); }
 	virtual bool CanSlowFallInCurrentState() const;
 
-	virtual float GetSlowFallGravityZScalar() const { return GetSlowFallParams() ? GetSlowFallParams()->GetGravityScalar(Velocity) : 1.f; }
+	virtual float GetSlowFallGravityZScalar() const
+	{
+		const FModifierEffectiveParams& Params = GetEffectiveModifierParams();
+		return Params.bSlowFall ? Params.SlowFall.GetGravityScalar(Velocity) : 1.f;
+	}
 	virtual bool RemoveVelocityZOnSlowFallStart() const;
 
 	/* ~SlowFall Implementation */
 
+protected:
+	/** Resolved from the current modifier levels, @see GetEffectiveModifierParams() */
+	mutable FModifierEffectiveParams EffectiveModifierParams;
+
+public:
+	/** Params combined across every active modifier, only resolved again when a modifier level changes */
+	const FModifierEffectiveParams& GetEffectiveModifierParams() const
+	{
+		if (!EffectiveModifierParams.IsResolvedFor(ModifierRegistry))
+		{
+			ResolveEffectiveModifierParams(EffectiveModifierParams);
+		}
+		return EffectiveModifierParams;
+	}
+
+	/** Resolve the combined params for the current modifier levels, override to combine your own modifiers */
+	virtual void ResolveEffectiveModifierParams(FModifierEffectiveParams& Params) const;
+
+	/** Params are only resolved when a modifier level changes, call this after changing a modifier's params at runtime */
+	UFUNCTION(BlueprintCallable, Category="Character Movement: Modifiers")
+	void InvalidateModifierParams() { EffectiveModifierParams.bResolved = false; }
+
 public:
 	virtual void ProcessModifierMovementState();
 	virtual void UpdateModifierMovementState();
 
+	/** Force every modifier family to be processed next time, regardless of bSkipUnchangedModifiers */
+	void InvalidateModifierProcessing();
+
 	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
 	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds) override;
+
+protected:
+	/** Applies replicated modifier levels that were deferred while the simulated proxy wasn't significant */
+	virtual void SimulatedTick(float DeltaSeconds) override;
 	
 public:
 	/* Client Auth Implementation */
 
 	virtual FClientAuthData* ProcessClientAuthData();
-	FClientAuthParams* GetClientAuthParamsForSource(const FGameplayTag& Source) { return ClientAuthParams.Find(Source); }
+	const FClientAuthParams* GetClientAuthParamsForSource(const FGameplayTag& Source) const;
 	virtual FClientAuthParams GetClientAuthParams(const FClientAuthData* ClientAuthData);
 
+	/** Call if ClientAuthParams or ModifierData's params are changed at runtime */
+	void InvalidateClientAuthParams() { bClientAuthParamsCached = false; }
+
 protected:
 	/**
 	 * Called when the client's position is rejected by the server entirely due to excessive difference
@@ -332,6 +745,14 @@ protected:
 	
 	/* ~Client Auth Implementation */
 	
+protected:
+	/** Move data and move responses are measured for p.PredictedMovement.Stats, @see FPredictedMovementScopedNetWriter */
+	virtual void CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove) override;
+	virtual void ServerSendMoveResponse(const FClientAdjustment& PendingAdjustment) override;
+
+	/** Queues the moves for UModifierMovementSubsystem while p.Modifier.BatchServerMoves is enabled */
+	virtual void ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer) override;
+
 public:
 	virtual void ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData) override;
 
@@ -362,7 +783,7 @@ protected:
 	virtual bool ClientUpdatePositionAfterServerUpdate() override;
 
 protected:
-	virtual void TickCharacterPose(float DeltaTime) override;  // ACharacter::GetAnimRootMotionTranslationScale() is non-virtual so we have to duplicate this entire function
+	virtual void TickCharacterPose(float DeltaTime) override;  // Applies GetRootMotionTranslationScalar() to root motion
 	
 private:
 	FModifierNetworkMoveDataContainer ModifierMoveDataContainer;
@@ -384,17 +805,14 @@ public:
 	virtual ~FSavedMove_Character_Modifier() override
 	{}
 
-	FModifierSavedMove BoostLocal;
-	FModifierSavedMove_WithCorrection BoostCorrection;
-	FModifierSavedMove_ServerInitiated BoostServer;
-	
-	FModifierSavedMove_ServerInitiated SnareServer;
+	/** Stacks of every modifier slot, laid out by UModifierMovement::GetModifierRegistry() */
+	FModifierStacks Stacks;
 
-	FModifierSavedMove SlowFallLocal;
+	/** Level of every modifier family at the start of the move */
+	TArray<TModSize, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Levels;
 
-	uint8 BoostLevel = NO_MODIFIER;
-	uint8 SnareLevel = NO_MODIFIER;
-	uint8 SlowFallLevel = NO_MODIFIER;
+	/** How every family was resolved when the move was recorded, replays skip families whose inputs still match */
+	FModifierResolvedMove ResolvePasses[static_cast<int32>(EModifierResolvePass::Num)];
 	
 	/** Clear saved move properties, so it can be re-used. */
 	virtual void Clear() override;
@@ -405,6 +823,12 @@ public:
 	/** Returns true if this move can be combined with NewMove for replication without changing any behavior */
 	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
 
+protected:
+	/** CanCombineWith for EModifierCombinePolicy::Relaxed */
+	bool CanCombineWithRelaxed(const FSavedMove_Character_Modifier& NewMove, const UModifierMovement& MoveComp,
+		const FSavedMovePtr& NewMovePtr, ACharacter* InCharacter, float MaxDelta) const;
+
+public:
 	/** Set the properties describing the position, etc. of the moved pawn at the start of the move. */
 	virtual void SetInitialPosition(ACharacter* C) override;
 
@@ -414,6 +838,9 @@ public:
 	/** Set the properties describing the final position, etc. of the moved pawn. */
 	virtual void PostUpdate(ACharacter* C, EPostUpdateMode PostUpdateMode) override;
 
+	/** Called before ClientUpdatePosition uses this SavedMove to make a predictive correction */
+	virtual void PrepMoveFor(ACharacter* C) override;
+
 	/** Returns true if this move is an "important" move that should be sent again if not acked by the server */
 	virtual bool IsImportantMove(const FSavedMovePtr& LastAckedMove) const override;
 };
@@ -428,4 +855,7 @@ public:
 	{}
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+protected:
+	TPredictedSavedMoveSlab<FSavedMove_Character_Modifier> MoveSlab;
 };
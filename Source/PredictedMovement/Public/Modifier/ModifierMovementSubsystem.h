@@ -0,0 +1,44 @@
+// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ModifierMovementSubsystem.generated.h"
+
+class UModifierMovement;
+
+/**
+ * Server only, opt-in with p.Modifier.BatchServerMoves
+ * Collects the server moves received this frame for every UModifierMovement, resolves their modifier levels for all
+ * characters in parallel, then performs the moves and handles corrections on the game thread
+ * Moves are performed later in the same frame, before replication, in the order they were received per character
+ */
+UCLASS()
+class PREDICTEDMOVEMENT_API UModifierMovementSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+	/** Characters with queued server moves, in the order they were first queued this frame */
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<UModifierMovement>> PendingMovements;
+
+public:
+	/** @return True if server moves should be queued for this subsystem to perform */
+	static bool IsBatchingServerMoves();
+
+	/** Called by UModifierMovement the first time it queues a server move each frame */
+	void AddPendingMovement(UModifierMovement* Movement);
+
+	/** Perform every queued server move now */
+	void PerformPendingServerMoves();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return PendingMovements.Num() > 0; }
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
@@ -0,0 +1,191 @@
+// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "ModifierImpl.h"
+#include "ModifierTypes.h"
+
+class UModifierMovement;
+
+// Every slot has a bit in the move data presence mask and the move response correction mask
+#define MAX_MODIFIER_SLOTS 32
+
+// Inline capacity of the per-slot arrays, enough for the built-in modifiers without heap allocations
+#define NUM_INLINE_MODIFIER_SLOTS 8
+
+/**
+ * One modifier stack within a family, e.g. BoostCorrection is a slot of the Boost family
+ * The net type determines how the slot is predicted, sent and corrected
+ */
+struct PREDICTEDMOVEMENT_API FModifierSlot
+{
+	FMovementModifier* Modifier = nullptr;
+	EModifierNetType NetType = EModifierNetType::LocalPredicted;
+	const TCHAR* Name = nullptr;
+
+	/** Index of the family this slot belongs to */
+	uint8 Family = 0;
+
+	/** Index into FModifierStacks::WantsModifiers, or INDEX_NONE if the client doesn't predict this slot */
+	int8 WantsIndex = INDEX_NONE;
+
+	/** Index into FModifierStacks::Modifiers, or INDEX_NONE if the server doesn't correct this slot */
+	int8 ModifiersIndex = INDEX_NONE;
+
+	/** The client predicts WantsModifiers from input, saves them in each move and sends them to the server */
+	static bool IsPredicted(EModifierNetType InNetType) { return InNetType != EModifierNetType::ServerInitiated; }
+
+	/** The client sends Modifiers so the server can compare them, and the server corrects them */
+	static bool IsCorrected(EModifierNetType InNetType) { return InNetType != EModifierNetType::LocalPredicted; }
+};
+
+/**
+ * Describes a slot when registering a family
+ * @see FModifierRegistry::AddFamily
+ */
+struct FModifierSlotDesc
+{
+	FMovementModifier* Modifier;
+	EModifierNetType NetType;
+	const TCHAR* Name;
+};
+
+/**
+ * A family of modifier slots that resolve to a single level, e.g. Boost
+ */
+struct PREDICTEDMOVEMENT_API FModifierFamily
+{
+	using FCanActivateFunc = bool (UModifierMovement::*)() const;
+
+	/** The modifier type, passed to AModifierCharacter::NotifyModifierChanged */
+	FGameplayTag Type;
+
+	/** The level this family resolves to, owned by the movement component */
+	TModSize* Level = nullptr;
+
+	/** Whether the family can be active in the current state, e.g. CanBoostInCurrentState */
+	FCanActivateFunc CanActivate = nullptr;
+
+	/** Level table and settings in use, refreshed by UModifierMovement::BuildModifierLevelTables */
+	const FModifierLevelTableBase* Levels = nullptr;
+	EModifierLevelMethod Method = EModifierLevelMethod::Max;
+	bool bLimitMaxModifiers = true;
+	int32 MaxModifiers = 8;
+
+	/** Contiguous range of this family's slots */
+	uint8 FirstSlot = 0;
+	uint8 NumSlots = 0;
+
+	/** What the family was last processed with, used by UModifierMovement::bSkipUnchangedModifiers */
+	FModifierProcessCache ProcessCache;
+
+	int32 NumLevels() const { return Levels ? Levels->Num() : 0; }
+	FGameplayTag GetLevelTag(TModSize Index) const { return Levels ? Levels->GetLevel(Index) : FGameplayTag::EmptyTag; }
+	TModSize GetLevelIndex(const FGameplayTag& Tag) const { return Levels ? Levels->GetIndex(Tag) : NO_MODIFIER; }
+
+	/** Refresh the level table and settings */
+	void SetLevels(const FModifierLevelTableBase& InLevels, EModifierLevelMethod InMethod, bool bInLimitMaxModifiers, int32 InMaxModifiers)
+	{
+		Levels = &InLevels;
+		Method = InMethod;
+		bLimitMaxModifiers = bInLimitMaxModifiers;
+		MaxModifiers = InMaxModifiers;
+		ProcessCache.Invalidate();
+	}
+};
+
+/**
+ * Contiguous modifier stacks for every slot of a registry, used by saved moves and move data
+ * Only predicted slots have WantsModifiers and only corrected slots have Modifiers, so no space is wasted per move
+ */
+struct PREDICTEDMOVEMENT_API FModifierStacks
+{
+	/** Indexed by FModifierSlot::WantsIndex */
+	TArray<TModifierStack, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> WantsModifiers;
+
+	/** Indexed by FModifierSlot::ModifiersIndex */
+	TArray<TModifierStack, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Modifiers;
+
+	/** Empty every stack, but keep the layout */
+	void Reset()
+	{
+		for (TModifierStack& Stack : WantsModifiers) { Stack.Reset(); }
+		for (TModifierStack& Stack : Modifiers) { Stack.Reset(); }
+	}
+
+	bool operator==(const FModifierStacks& Other) const
+	{
+		return WantsModifiers == Other.WantsModifiers && Modifiers == Other.Modifiers;
+	}
+
+	bool operator!=(const FModifierStacks& Other) const { return !(*this == Other); }
+};
+
+/**
+ * Every modifier family of a movement component, and their slots
+ * The saved move, move data, move response, correction checks and simulated proxy replication all iterate this
+ * instead of naming each modifier, so adding a modifier type is a single AddFamily() call
+ */
+struct PREDICTEDMOVEMENT_API FModifierRegistry
+{
+	TArray<FModifierFamily, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Families;
+	TArray<FModifierSlot, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> Slots;
+
+	/** The modifier of each slot, so a family's slots can be viewed contiguously */
+	TArray<FMovementModifier*, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> SlotModifiers;
+
+	/** Slot indices of the predicted and corrected stacks, parallel to FModifierStacks */
+	TArray<uint8, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> PredictedSlots;
+	TArray<uint8, TInlineAllocator<NUM_INLINE_MODIFIER_SLOTS>> CorrectedSlots;
+
+	/**
+	 * Register a modifier family and its slots
+	 * Client and server must register the same families in the same order, they are identified by index on the wire
+	 * @param Type The modifier type, e.g. FModifierTags::Modifier_Boost
+	 * @param Level The level the family resolves to
+	 * @param CanActivate Whether the family can be active in the current state, static_cast derived class functions
+	 * @param InSlots The modifier stacks of the family, in the order they consume the MaxModifiers limit
+	 * @return The index of the family
+	 */
+	int32 AddFamily(const FGameplayTag& Type, TModSize& Level, FModifierFamily::FCanActivateFunc CanActivate,
+		std::initializer_list<FModifierSlotDesc> InSlots);
+
+	/** @return The index of the family of Type, or INDEX_NONE */
+	int32 FindFamily(const FGameplayTag& Type) const
+	{
+		return Families.IndexOfByPredicate([&Type](const FModifierFamily& Family) { return Family.Type == Type; });
+	}
+
+	/** @return The first slot of the family with NetType, or nullptr if the family has none */
+	const FModifierSlot* FindSlot(int32 FamilyIndex, EModifierNetType NetType) const;
+
+	/** @return Every slot's modifier of the family, in order */
+	TArrayView<FMovementModifier* const> GetFamilyModifiers(const FModifierFamily& Family) const
+	{
+		return MakeArrayView(SlotModifiers.GetData() + Family.FirstSlot, Family.NumSlots);
+	}
+
+	int32 NumPredicted() const { return PredictedSlots.Num(); }
+	int32 NumCorrected() const { return CorrectedSlots.Num(); }
+
+	/** Size Stacks for this registry */
+	void InitStacks(FModifierStacks& Stacks) const
+	{
+		Stacks.WantsModifiers.SetNum(NumPredicted(), EAllowShrinking::No);
+		Stacks.Modifiers.SetNum(NumCorrected(), EAllowShrinking::No);
+	}
+
+	/** Copy WantsModifiers of every predicted slot into Stacks */
+	void GatherWantsModifiers(FModifierStacks& Stacks) const;
+
+	/** Copy Modifiers of every corrected slot into Stacks */
+	void GatherModifiers(FModifierStacks& Stacks) const;
+
+	/** Apply WantsModifiers of every predicted slot from Stacks */
+	void ApplyWantsModifiers(const FModifierStacks& Stacks) const;
+
+	/** The number of levels of the family a slot belongs to, this determines how many bits each level is packed to */
+	int32 GetSlotNumLevels(int32 SlotIndex) const { return Families[Slots[SlotIndex].Family].NumLevels(); }
+};
@@ -5,11 +5,35 @@
 #include "CoreMinimal.h"
 #include "NativeGameplayTags.h"
 
+/**
+ * Every built-in modifier type with its native tag, in the order UModifierMovement registers their families
+ * Op(Name, Tag, Comment)
+ */
+#define PREDICTED_MODIFIER_TYPES(Op) \
+	Op(Boost,		"Modifier.Boost",		"Increase Movement Speed") \
+	Op(Snare,		"Modifier.Snare",		"Reduced Movement Speed applied by server") \
+	Op(SlowFall,	"Modifier.SlowFall",	"Reduce Gravity to a % of its normal value")
+
+/**
+ * Compile-time ID of a built-in modifier type, this is also its family index in UModifierMovement's registry
+ * Native code switches on or indexes by this, tags are only used at the Blueprint and config boundary
+ */
+enum class EModifierType : uint8
+{
+#define PREDICTED_MODIFIER_TYPE_ENUM(Name, Tag, Comment) Name,
+	PREDICTED_MODIFIER_TYPES(PREDICTED_MODIFIER_TYPE_ENUM)
+#undef PREDICTED_MODIFIER_TYPE_ENUM
+	Num
+};
+
 namespace FModifierTags
 {
-	PREDICTEDMOVEMENT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Modifier_Boost);
-	PREDICTEDMOVEMENT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Modifier_SlowFall);
-	PREDICTEDMOVEMENT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Modifier_Snare);
+#define PREDICTED_MODIFIER_TYPE_TAG(Name, Tag, Comment) PREDICTEDMOVEMENT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Modifier_##Name);
+	PREDICTED_MODIFIER_TYPES(PREDICTED_MODIFIER_TYPE_TAG)
+#undef PREDICTED_MODIFIER_TYPE_TAG
 	
 	PREDICTEDMOVEMENT_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(ClientAuth_Snare);
+
+	/** @return The native tag of a built-in modifier type */
+	PREDICTEDMOVEMENT_API FGameplayTag GetModifierTypeTag(EModifierType Type);
 }
\ No newline at end of file
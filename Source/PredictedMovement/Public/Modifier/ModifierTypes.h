@@ -4,11 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "GameplayTagContainer.h"
+#include "Containers/StaticArray.h"
 #include "Curves/CurveFloat.h"
 #include "ModifierTypes.generated.h"
 
 #define NO_MODIFIER UINT8_MAX
 
+// GrantClientAuthority() keeps at most this many client auth entries, the oldest is removed to make room
+#define MAX_CLIENT_AUTH_STACK_SIZE 8
+
 /**
  * The network type of the modifier, which determines how it is applied and synchronized across clients and servers
  */
@@ -42,6 +46,16 @@ enum class EModifierLevelMethod : uint8
 	Average 			UMETA(ToolTip="The average modifier level will be applied"),
 };
 
+/**
+ * When the client may combine saved moves that differ in modifier state
+ */
+UENUM(BlueprintType)
+enum class EModifierCombinePolicy : uint8
+{
+	Strict				UMETA(ToolTip="Only combine moves with identical WantsModifiers and levels"),
+	Relaxed				UMETA(ToolTip="Also combine moves whose WantsModifiers differ but resolve to the same levels, and ignore server initiated levels. Fewer moves are sent, but modifier events can be replayed"),
+};
+
 UENUM(BlueprintType)
 enum class EModifierFallZ : uint8
 {
@@ -122,6 +136,7 @@ struct PREDICTEDMOVEMENT_API FFallingModifierParams
 		: bGravityScalarFromVelocityZ(false)
 		, GravityScalar(InGravityScalar)
 		, GravityScalarFallVelocityCurve(nullptr)
+		, bBakeGravityScalarCurve(true)
 		, RemoveVelocityZOnStart(InRemoveVelocityZ)
 		, bOverrideAirControl(false)
 		, AirControlScalar(1.f)
@@ -140,6 +155,15 @@ struct PREDICTEDMOVEMENT_API FFallingModifierParams
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Modifier, meta=(EditCondition="bGravityScalarFromVelocityZ", EditConditionHides))
 	UCurveFloat* GravityScalarFallVelocityCurve;
 
+	/**
+	 * If true, GravityScalarFallVelocityCurve is baked into evenly spaced samples when the level tables are built
+	 * Evaluating it is then an interpolation between two samples instead of evaluating the curve
+	 * Velocities outside the curve's time range are clamped, the same as constant extrapolation
+	 * Changes to the curve asset require the level tables to be rebuilt, @see UModifierMovement::BuildModifierLevelTables
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Modifier, AdvancedDisplay, meta=(EditCondition="bGravityScalarFromVelocityZ", EditConditionHides))
+	bool bBakeGravityScalarCurve;
+
 	/** Set Velocity.Z = 0.f when air fall starts */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Modifier, meta=(DisplayName="Remove Velocity Z On Start"))
 	EModifierFallZ RemoveVelocityZOnStart;
@@ -162,6 +186,16 @@ struct PREDICTEDMOVEMENT_API FFallingModifierParams
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Modifier, meta=(EditCondition="bOverrideAirControl", EditConditionHides))
 	float AirControlOverride;
 
+	/** Fixed size, so copying the params e.g. into FModifierEffectiveParams never allocates */
+	static constexpr int32 NumGravityScalarSamples = 64;
+	static_assert(NumGravityScalarSamples >= 2, "Interpolation needs at least two samples");
+
+	/** GravityScalarFallVelocityCurve baked by BakeGravityScalarCurve(), only valid if bGravityScalarBaked */
+	TStaticArray<float, NumGravityScalarSamples> GravityScalarSamples;
+	bool bGravityScalarBaked = false;
+	float GravitySampleMinVelocityZ = 0.f;
+	float GravitySampleInvInterval = 0.f;
+
 	/**
 	 * Get the gravity scalar based on the current velocity.
 	 * If bGravityScalarFromVelocityZ is true, uses GravityScalarFallVelocityCurve to determine the scalar based on Velocity.Z.
@@ -169,11 +203,48 @@ struct PREDICTEDMOVEMENT_API FFallingModifierParams
 	 */
 	float GetGravityScalar(const FVector& Velocity) const
 	{
-		if (!ensureMsgf(!bGravityScalarFromVelocityZ || GravityScalarFallVelocityCurve != nullptr, TEXT("GravityScalarFallVelocityCurve must be set")))
+		if (!bGravityScalarFromVelocityZ)
+		{
+			return GravityScalar;
+		}
+
+		if (bGravityScalarBaked)
+		{
+			const float Alpha = FMath::Clamp<float>((Velocity.Z - GravitySampleMinVelocityZ) * GravitySampleInvInterval,
+				0.f, static_cast<float>(NumGravityScalarSamples - 1));
+			const int32 Index = FMath::Min(FMath::FloorToInt32(Alpha), NumGravityScalarSamples - 2);
+			return FMath::Lerp(GravityScalarSamples[Index], GravityScalarSamples[Index + 1], Alpha - Index);
+		}
+
+		if (!ensureMsgf(GravityScalarFallVelocityCurve != nullptr, TEXT("GravityScalarFallVelocityCurve must be set")))
 		{
 			return 1.f;
 		}
-		return bGravityScalarFromVelocityZ ? GravityScalarFallVelocityCurve->GetFloatValue(Velocity.Z) : GravityScalar;
+		return GravityScalarFallVelocityCurve->GetFloatValue(Velocity.Z);
+	}
+
+	/** Bake GravityScalarFallVelocityCurve into GravityScalarSamples, called when the level tables are built */
+	void BakeGravityScalarCurve()
+	{
+		bGravityScalarBaked = false;
+		if (!bGravityScalarFromVelocityZ || !bBakeGravityScalarCurve || !GravityScalarFallVelocityCurve)
+		{
+			return;
+		}
+
+		float MinTime = 0.f;
+		float MaxTime = 0.f;
+		GravityScalarFallVelocityCurve->GetTimeRange(MinTime, MaxTime);
+
+		const float Interval = (MaxTime - MinTime) / (NumGravityScalarSamples - 1);
+		GravitySampleMinVelocityZ = MinTime;
+		GravitySampleInvInterval = Interval > UE_KINDA_SMALL_NUMBER ? 1.f / Interval : 0.f;
+
+		bGravityScalarBaked = true;
+		for (int32 i = 0; i < NumGravityScalarSamples; ++i)
+		{
+			GravityScalarSamples[i] = GravityScalarFallVelocityCurve->GetFloatValue(MinTime + Interval * i);
+		}
 	}
 
 	/**
@@ -188,6 +259,12 @@ struct PREDICTEDMOVEMENT_API FFallingModifierParams
 	}
 };
 
+/** Bake the gravity curve of each SlowFall level when its level table is built */
+inline void PostBuildModifierLevelParams(FFallingModifierParams& Params)
+{
+	Params.BakeGravityScalarCurve();
+}
+
 /**
  * Client auth parameters for providing client with partial positional authority
  * These parameters can be used to configure how the client can send position updates to the server
@@ -320,18 +397,28 @@ struct PREDICTEDMOVEMENT_API FClientAuthData
 
 /**
  * Stack of client auth data for providing client with positional authority
+ * Server only, kept in priority order on insert so the most important data is always first
+ * Fixed capacity, this never allocates
  */
 USTRUCT()
 struct PREDICTEDMOVEMENT_API FClientAuthStack
 {
 	GENERATED_BODY()
 
+	using TStack = TArray<FClientAuthData, TFixedAllocator<MAX_CLIENT_AUTH_STACK_SIZE>>;
+
 	FClientAuthStack()
 	{}
 
-	/** Stack of client auth data */
-	UPROPERTY()
-	TArray<FClientAuthData> Stack;
+	/** Stack of client auth data, in ascending priority order, and insertion order within a priority */
+	TStack Stack;
+
+protected:
+	/** Incremented whenever data is added or removed, used to cache anything derived from the stack */
+	uint32 Revision = 0;
+
+public:
+	uint32 GetRevision() const { return Revision; }
 
 	bool operator==(const FClientAuthStack& Other) const
 	{
@@ -344,44 +431,62 @@ struct PREDICTEDMOVEMENT_API FClientAuthStack
 	}
 
 	/**
-	 * Sorts the stack by priority, in ascending order
-	 * Lower priority values are more important
+	 * Insert the data in priority order
+	 * If the stack is full, the oldest data is removed to make room
 	 */
-	void SortByPriority()
+	void Push(const FClientAuthData& Data)
 	{
-		Stack.Sort([](const FClientAuthData& A, const FClientAuthData& B)
+		if (Stack.Num() >= MAX_CLIENT_AUTH_STACK_SIZE)
 		{
-			return A.Priority < B.Priority;
-		});
+			// Ids are incremented on each grant, the lowest is the oldest
+			int32 OldestIndex = 0;
+			for (int32 i = 1; i < Stack.Num(); ++i)
+			{
+				if (Stack[i].Id < Stack[OldestIndex].Id)
+				{
+					OldestIndex = i;
+				}
+			}
+			Stack.RemoveAt(OldestIndex, 1, EAllowShrinking::No);
+		}
+
+		// After every entry of the same or more important priority
+		int32 InsertIndex = 0;
+		while (InsertIndex < Stack.Num() && Stack[InsertIndex].Priority <= Data.Priority)
+		{
+			++InsertIndex;
+		}
+		Stack.Insert(Data, InsertIndex);
+		++Revision;
 	}
 
 	/**
 	 * Filters the stack by priority, returning only the data with the specified priority
 	 * @param Priority The priority to filter by
-	 * @return An array of FClientAuthData with the specified priority
+	 * @return The FClientAuthData with the specified priority
 	 */
-	TArray<FClientAuthData> FilterPriority(int32 Priority) const
+	TStack FilterPriority(int32 Priority) const
 	{
-		return Stack.FilterByPredicate([Priority](const FClientAuthData& AuthData)
+		TStack Result;
+		for (const FClientAuthData& AuthData : Stack)
 		{
-			return AuthData.Priority == Priority;
-		});
+			if (AuthData.Priority == Priority)
+			{
+				Result.Add(AuthData);
+			}
+		}
+		return Result;
 	}
 
 	/**
 	 * Determines the lowest priority in the stack
 	 */
-	int32 DetermineLowestPriority()
+	int32 DetermineLowestPriority() const
 	{
-		if (Stack.Num() == 0)
-		{
-			return INT32_MAX;
-		}
-		SortByPriority();
-		return Stack[0].Priority;
+		return Stack.Num() > 0 ? Stack[0].Priority : INT32_MAX;
 	}
 
-	TArray<FClientAuthData> GetLowestPriority()
+	TStack GetLowestPriority() const
 	{
 		return FilterPriority(DetermineLowestPriority());
 	}
@@ -396,58 +501,82 @@ struct PREDICTEDMOVEMENT_API FClientAuthStack
 		return Stack.Num() > 0 ? &Stack[0] : nullptr;
 	}
 
+	/** @return The most recently granted data */
 	FClientAuthData* GetLatest()
 	{
-		return Stack.Num() > 0 ? &Stack.Last() : nullptr;
+		return const_cast<FClientAuthData*>(static_cast<const FClientAuthStack*>(this)->GetLatest());
 	}
 
-	void RemoveFirst()
+	const FClientAuthData* GetLatest() const
 	{
-		if (Stack.Num() > 0)
+		const FClientAuthData* Latest = nullptr;
+		for (const FClientAuthData& Data : Stack)
 		{
-			Stack.RemoveAt(0);
+			Latest = !Latest || Data.Id > Latest->Id ? &Data : Latest;
 		}
-	}
-	
-	const FClientAuthData* GetLatest() const
-	{
-		return Stack.Num() > 0 ? &Stack.Last() : nullptr;
+		return Latest;
 	}
 
-	void RemoveLatest()
+	void RemoveFirst()
 	{
 		if (Stack.Num() > 0)
 		{
-			Stack.RemoveAt(Stack.Num() - 1);
+			Stack.RemoveAt(0, 1, EAllowShrinking::No);
+			++Revision;
 		}
 	}
 
+	void RemoveLatest()
+	{
+		RemoveData(GetLatest());
+	}
+
 	void RemoveData(const FClientAuthData* Data)
 	{
 		if (Data)
 		{
-			Stack.Remove(*Data);
+			// Copy, Data may point into the stack
+			const FClientAuthData ToRemove = *Data;
+			if (Stack.RemoveSingle(ToRemove) > 0)
+			{
+				++Revision;
+			}
 		}
 	}
 
 	void RemoveAllDataForSource(const FGameplayTag& Source)
 	{
-		Stack.RemoveAll([Source](const FClientAuthData& Data)
+		if (Stack.RemoveAll([Source](const FClientAuthData& Data) { return Data.Source == Source; }) > 0)
 		{
-			return Data.Source == Source;
-		});
+			++Revision;
+		}
 	}
 
 	/**
 	 * Updates the time remaining for each client auth data in the stack
 	 * And removes any data that has expired (TimeRemaining <= 0)
+	 * Expired data is compacted out in a single pass that preserves priority order
 	 */
 	void Update(float DeltaTime)
 	{
-		Stack.RemoveAll([DeltaTime](FClientAuthData& Data)
+		int32 Num = 0;
+		for (int32 i = 0; i < Stack.Num(); ++i)
 		{
-			Data.TimeRemaining -= DeltaTime;
-			return Data.TimeRemaining <= 0.f;
-		});
+			Stack[i].TimeRemaining -= DeltaTime;
+			if (Stack[i].TimeRemaining > 0.f)
+			{
+				if (Num != i)
+				{
+					Stack[Num] = Stack[i];
+				}
+				++Num;
+			}
+		}
+
+		if (Num != Stack.Num())
+		{
+			Stack.SetNum(Num, EAllowShrinking::No);
+			++Revision;
+		}
 	}
 };
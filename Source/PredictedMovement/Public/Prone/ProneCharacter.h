@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "System/PredictedMovementSignificance.h"
 #include "ProneCharacter.generated.h"
 
 class UProneMovement;
@@ -49,6 +50,18 @@ public:
 	UFUNCTION()
 	virtual void OnRep_IsProned();
 
+	/** Apply a deferred OnRep_IsProned() once this simulated proxy is significant again */
+	void FlushDeferredProneRep();
+	bool HasDeferredProneRep() const { return DeferredProneRep.bPending; }
+
+protected:
+	/** bIsProned changes of a simulated proxy that isn't significant, @see PredictedMovementSignificance */
+	FPredictedProxyDeferredState DeferredProneRep;
+
+	/** Apply the replicated bIsProned to the movement component */
+	virtual void ApplyProneRep();
+
+public:
 	/**
 	 * Request the character to start Proned. The request is processed on the next update of the CharacterMovementComponent.
 	 * @see OnStartProne
@@ -4,9 +4,44 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "System/PredictedSavedMovePool.h"
 #include "ProneMovement.generated.h"
 
 class AProneCharacter;
+
+/**
+ * A failed UnProne() encroachment test, so it isn't repeated every tick while the character remains under geometry
+ * Only a matching key reuses the result, and it expires on the move timestamp so client and server expire it on the same move
+ */
+struct PREDICTEDMOVEMENT_API FProneEncroachmentCache
+{
+	/** Movement base the test was made on, dynamic bases are not cached */
+	TWeakObjectPtr<const UPrimitiveComponent> Base = nullptr;
+
+	/** Quantized location the test was made at */
+	FIntVector Cell = FIntVector::ZeroValue;
+
+	/** Unscaled capsule dimensions the test was made with */
+	float Radius = 0.f;
+	float HalfHeight = 0.f;
+	float ScaledHalfHeightAdjust = 0.f;
+
+	/** Timestamps the result is valid between, from UProneMovement::GetTimestamp(), which can be reset */
+	float Timestamp = -1.f;
+	float ExpiryTimestamp = -1.f;
+
+	bool bValid = false;
+
+	void Invalidate() { bValid = false; }
+
+	bool Matches(const UPrimitiveComponent* InBase, const FIntVector& InCell, float InRadius, float InHalfHeight,
+		float InScaledHalfHeightAdjust, float InTimestamp) const
+	{
+		return bValid && InTimestamp >= Timestamp && InTimestamp < ExpiryTimestamp && Cell == InCell && Base.Get() == InBase &&
+			Radius == InRadius && HalfHeight == InHalfHeight && ScaledHalfHeightAdjust == InScaledHalfHeightAdjust;
+	}
+};
+
 UCLASS()
 class PREDICTEDMOVEMENT_API UProneMovement : public UCharacterMovementComponent
 {
@@ -69,6 +104,21 @@ public:
 	UPROPERTY(Category="Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, meta=(ClampMin="0", UIMin="0", ForceUnits=cm))
 	float ProneLockDuration;
 	
+	/**
+	 * If true, a failed UnProne() is cached so the encroachment tests are not repeated each tick or replayed move
+	 * The tests only re-run once the character moves to another cell, changes base or capsule size, or the cache expires
+	 */
+	UPROPERTY(Category="Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, AdvancedDisplay)
+	bool bCacheUnProneEncroachment = true;
+
+	/** Size of the cells the location is quantized to, moving to another cell re-runs the tests */
+	UPROPERTY(Category="Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta=(ClampMin="0.1", UIMin="0.1", ForceUnits=cm, EditCondition="bCacheUnProneEncroachment"))
+	float UnProneEncroachmentCellSize = 5.f;
+
+	/** How long a failed UnProne() is cached for, in case the geometry above the character changes */
+	UPROPERTY(Category="Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite, AdvancedDisplay, meta=(ClampMin="0", UIMin="0", ForceUnits=s, EditCondition="bCacheUnProneEncroachment"))
+	float UnProneEncroachmentCacheDuration = 0.25f;
+
 	/** If true, Character can walk off a ledge when proned. */
 	UPROPERTY(Category="Character Movement: Walking", EditAnywhere, BlueprintReadWrite)
 	uint8 bCanWalkOffLedgesWhenProned:1;
@@ -84,6 +134,16 @@ public:
 protected:
 	float ProneLockTimestamp = -1.f;
 
+	/** Last failed UnProne() encroachment test */
+	FProneEncroachmentCache UnProneEncroachmentCache;
+
+	/** @return The quantized location used by UnProneEncroachmentCache */
+	FIntVector GetUnProneEncroachmentCell(const FVector& Location) const;
+
+public:
+	/** Discard the cached UnProne() encroachment test, e.g. when the geometry above the character is changed */
+	void InvalidateUnProneEncroachmentCache() { UnProneEncroachmentCache.Invalidate(); }
+
 public:
 	UProneMovement(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 	
@@ -138,6 +198,9 @@ public:
 	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds) override;
 
 protected:
+	/** Applies replicated state that was deferred while the simulated proxy wasn't significant */
+	virtual void SimulatedTick(float DeltaSeconds) override;
+
 	virtual bool ClientUpdatePositionAfterServerUpdate() override;
 
 	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
@@ -184,4 +247,7 @@ public:
 	{}
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+protected:
+	TPredictedSavedMoveSlab<FSavedMove_Character_Prone> MoveSlab;
 };
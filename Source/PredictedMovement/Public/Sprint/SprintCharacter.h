@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "System/PredictedMovementSignificance.h"
 #include "SprintCharacter.generated.h"
 
 class USprintMovement;
@@ -58,6 +59,18 @@ public:
 	UFUNCTION()
 	virtual void OnRep_IsSprinting();
 
+	/** Apply a deferred OnRep_IsSprinting() once this simulated proxy is significant again */
+	void FlushDeferredSprintRep();
+	bool HasDeferredSprintRep() const { return DeferredSprintRep.bPending; }
+
+protected:
+	/** bIsSprinting changes of a simulated proxy that isn't significant, @see PredictedMovementSignificance */
+	FPredictedProxyDeferredState DeferredSprintRep;
+
+	/** Apply the replicated bIsSprinting to the movement component */
+	virtual void ApplySprintRep();
+
+public:
 	/**
 	 * Request the character to start Sprinting. The request is processed on the next update of the CharacterMovementComponent.
 	 * @see OnStartSprint
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "System/PredictedSavedMovePool.h"
 #include "SprintMovement.generated.h"
 
 class ASprintCharacter;
@@ -81,6 +82,22 @@ public:
 	UPROPERTY(Category="Character Movement (General Settings)", VisibleInstanceOnly, BlueprintReadOnly)
 	uint8 bWantsToSprint:1;
 
+protected:
+	/** Sprint state evaluated once by CalcVelocity, and shared by every getter called during that substep */
+	struct FSprintEvaluation
+	{
+		bool bValid = false;
+		bool bSprinting = false;
+		bool bAtSpeed = false;
+		bool bWithinInputAngle = false;
+	};
+
+	/** Only valid while CalcVelocity is running, the sprint state, velocity and acceleration can change outside of it */
+	FSprintEvaluation SprintEval;
+
+	/** Evaluate the current sprint state, without using SprintEval */
+	virtual FSprintEvaluation EvaluateSprint() const;
+
 public:
 	USprintMovement(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
@@ -95,7 +112,14 @@ public:
 
 public:
 	virtual bool IsSprintingAtSpeed() const;
-	virtual bool IsSprintingInEffect() const { return IsSprintingAtSpeed() && IsSprintWithinAllowableInputAngle(); }
+	virtual bool IsSprintingInEffect() const
+	{
+		if (SprintEval.bValid)
+		{
+			return SprintEval.bAtSpeed && SprintEval.bWithinInputAngle;
+		}
+		return IsSprintingAtSpeed() && IsSprintWithinAllowableInputAngle();
+	}
 
 	virtual float GetMaxAcceleration() const override;
 	virtual float GetMaxSpeed() const override;
@@ -138,6 +162,9 @@ public:
 	virtual void UpdateCharacterStateAfterMovement(float DeltaSeconds) override;
 
 protected:
+	/** Applies replicated state that was deferred while the simulated proxy wasn't significant */
+	virtual void SimulatedTick(float DeltaSeconds) override;
+
 	virtual bool ClientUpdatePositionAfterServerUpdate() override;
 	
 public:
@@ -182,4 +209,7 @@ public:
 	{}
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+protected:
+	TPredictedSavedMoveSlab<FSavedMove_Character_Sprint> MoveSlab;
 };
@@ -5,8 +5,68 @@
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "System/PredictedMovementVersioning.h"
+#include "System/PredictedSavedMovePool.h"
 #include "StaminaMovement.generated.h"
 
+/**
+ * Which rate of FStaminaRateModel applies, sent with each move instead of the stamina itself
+ * Packed to 2 bits, @see FStaminaNetworkMoveData
+ */
+enum class EStaminaSegment : uint8
+{
+	Idle,			// Neither draining nor regenerating, e.g. full
+	Draining,		// Consuming stamina
+	Regenerating,	// Regenerating stamina
+	Drained,		// Regenerating stamina until the recovery threshold is reached
+};
+
+/**
+ * Describes stamina as piecewise linear segments: a drain rate, a regen rate, a drain threshold and a recovery threshold
+ * Because each segment is linear, the stamina at the end of a move can be computed from the start of the move
+ * analytically, and two moves combined produce the same result as both moves performed in sequence
+ * This allows moves to be combined even when the drain state changes during them
+ */
+USTRUCT(BlueprintType)
+struct PREDICTEDMOVEMENT_API FStaminaRateModel
+{
+	GENERATED_BODY()
+
+	FStaminaRateModel()
+		: DrainRate(20.f)
+		, RegenRate(10.f)
+		, DrainedThreshold(0.f)
+		, RecoveredThreshold(1.f)
+	{}
+
+	/** Stamina consumed per second while UStaminaMovement::ShouldDrainStamina() */
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly, meta=(ClampMin="0.0", UIMin="0.0"))
+	float DrainRate;
+
+	/** Stamina regenerated per second otherwise */
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly, meta=(ClampMin="0.0", UIMin="0.0"))
+	float RegenRate;
+
+	/** Stamina becomes drained at or below this percentage of MaxStamina */
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly, meta=(ClampMin="0.0", UIMin="0.0", ClampMax="1.0", UIMax="1.0", ForceUnits="Multiplier"))
+	float DrainedThreshold;
+
+	/** Drained stamina recovers at or above this percentage of MaxStamina, e.g. 0.1 to allow sprinting again at 10% */
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly, meta=(ClampMin="0.0", UIMin="0.0", ClampMax="1.0", UIMax="1.0", ForceUnits="Multiplier"))
+	float RecoveredThreshold;
+
+	/**
+	 * Advance stamina over DeltaTime, crossing segments as required
+	 * Consuming stops once drained, the owner is expected to stop e.g. sprinting from OnStaminaDrained()
+	 * @param Stamina The stamina to advance
+	 * @param bDrained The drain state, updated by any threshold crossed
+	 * @return The stamina after DeltaTime
+	 */
+	float Advance(float Stamina, bool& bDrained, bool bConsuming, float MaxStamina, float DeltaTime) const;
+
+	/** @return The segment that applies to this state */
+	EStaminaSegment GetSegment(float Stamina, bool bDrained, bool bConsuming, float MaxStamina) const;
+};
+
 struct PREDICTEDMOVEMENT_API FStaminaMoveResponseDataContainer : FCharacterMoveResponseDataContainer
 {  // Server ➜ Client
 	using Super = FCharacterMoveResponseDataContainer;
@@ -24,12 +84,20 @@ struct PREDICTEDMOVEMENT_API FStaminaNetworkMoveData : FCharacterNetworkMoveData
  
     FStaminaNetworkMoveData()
         : Stamina(0)
+        , StaminaSegment(EStaminaSegment::Idle)
+        , bHasStamina(true)
     {}
  
     virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
     virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
  
     float Stamina;
+
+	/** Only sent when UStaminaMovement::bUseStaminaRateModel */
+	EStaminaSegment StaminaSegment;
+
+	/** With the rate model, Stamina is only sent when the server cannot reconstruct it from the segment */
+	bool bHasStamina;
 };
  
 struct PREDICTEDMOVEMENT_API FStaminaNetworkMoveDataContainer : FCharacterNetworkMoveDataContainer
@@ -48,8 +116,9 @@ private:
 };
 
 /**
- * Add a void CalcStamina(float DeltaTime) function to your UCharacterMovementComponent and call it before Super after
- * overriding CalcVelocity.
+ * Override CalcStamina(float DeltaTime) in your UCharacterMovementComponent and call it before Super after
+ * overriding CalcVelocity. Alternatively, enable bUseStaminaRateModel and override ShouldDrainStamina(), and stamina
+ * will drain and regenerate based on StaminaRateModel without any further work.
  * 
  * You will want to implement what happens based on the stamina yourself, eg. override GetMaxSpeed to move slowly
  * when bStaminaDrained.
@@ -88,6 +157,26 @@ public:
 	/** Maximum stamina difference that is allowed between client and server before a correction occurs. */
 	UPROPERTY(Category="Character Movement (Networking)", EditDefaultsOnly, meta=(ClampMin="0.0", UIMin="0.0"))
 	float NetworkStaminaCorrectionThreshold;
+
+	/**
+	 * Stamina is sent over the network in multiples of this, 0 sends a full float
+	 * The step is absolute, it doesn't depend on MaxStamina which the client may not agree on yet, e.g. from GAS
+	 * Keep it well below NetworkStaminaCorrectionThreshold, 0.025 sends 100 stamina in 16 bits
+	 */
+	UPROPERTY(Category="Character Movement (Networking)", EditDefaultsOnly, AdvancedDisplay, meta=(ClampMin="0.0", UIMin="0.0"))
+	float NetworkStaminaQuantizationStep;
+
+	/**
+	 * If true, stamina is driven by StaminaRateModel from CalcVelocity, @see CalcStamina()
+	 * Moves are then sent with a 2-bit segment instead of the stamina, which is only sent when the server cannot
+	 * reconstruct it, and moves can be combined across drain transitions
+	 * Don't also call CalcStamina() from your own CalcVelocity override when this is enabled
+	 */
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly)
+	bool bUseStaminaRateModel;
+
+	UPROPERTY(Category="Character Movement: Stamina", EditDefaultsOnly, meta=(EditCondition="bUseStaminaRateModel"))
+	FStaminaRateModel StaminaRateModel;
 	
 public:
 	UStaminaMovement(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
@@ -115,7 +204,28 @@ public:
 
 	void SetStaminaDrained(bool bNewValue);
 
+	/** Serialize a stamina value using NetworkStaminaQuantizationStep */
+	void NetSerializeStamina(FArchive& Ar, float& Value) const;
+
+	/** @return The segment of StaminaRateModel that currently applies */
+	EStaminaSegment GetStaminaSegment() const
+	{
+		return StaminaRateModel.GetSegment(Stamina, bStaminaDrained, ShouldDrainStamina(), MaxStamina);
+	}
+
+	/**
+	 * Whether stamina is being consumed, used by StaminaRateModel
+	 * Override this, e.g. return IsSprinting() when used with sprinting
+	 */
+	virtual bool ShouldDrainStamina() const { return false; }
+
 protected:
+	/** Advance stamina using StaminaRateModel, called from CalcVelocity when bUseStaminaRateModel */
+	virtual void CalcStamina(float DeltaTime);
+
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+
+
 	/*
 	 * Drain state entry and exit is handled here. Drain state is used to prevent rapid re-entry of sprinting or other
 	 * such abilities before sufficient stamina has regenerated. However, in the default implementation, 100%
@@ -131,6 +241,18 @@ private:
 	FStaminaMoveResponseDataContainer StaminaMoveResponseDataContainer;
 
 	FStaminaNetworkMoveDataContainer StaminaMoveDataContainer;
+
+	/** True while CalcStamina is applying StaminaRateModel, so SetStamina() can tell model changes from external ones */
+	bool bAdvancingStamina = false;
+
+	/**
+	 * Set on the server when stamina is changed outside StaminaRateModel (e.g. by GAS), the client only sends its
+	 * segment so can't be compared against, a correction is forced instead so the client receives the new stamina
+	 */
+	bool bStaminaChangedOutsideModel = false;
+
+	/** Flag an external stamina change on the server, @see bStaminaChangedOutsideModel */
+	void MarkStaminaChangedOutsideModel();
 	
 public:
 	/*
@@ -153,6 +275,10 @@ public:
 		const FVector& ClientWorldLocation, const FVector& RelativeClientLocation,
 		UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
 
+	/** Move data and move responses are measured for p.PredictedMovement.Stats, @see FPredictedMovementScopedNetWriter */
+	virtual void CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove) override;
+	virtual void ServerSendMoveResponse(const FClientAdjustment& PendingAdjustment) override;
+
 	/** Get prediction data for a client game. Should not be used if not running as a client. Allocates the data on demand and can be overridden to allocate a custom override if desired. Result must be a FNetworkPredictionData_Client_Character. */
 	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
 };
@@ -164,6 +290,9 @@ class PREDICTEDMOVEMENT_API FSavedMove_Character_Stamina : public FSavedMove_Cha
 public:
 	FSavedMove_Character_Stamina()
 		: bStaminaDrained(0)
+		, bConsumingStamina(0)
+		, bSendStamina(1)
+		, EndStaminaSegment(EStaminaSegment::Idle)
 		, StartStamina(0)
 		, EndStamina(0)
 	{}
@@ -172,6 +301,14 @@ public:
 	{}
 
 	uint8 bStaminaDrained : 1;
+
+	/** UStaminaMovement::ShouldDrainStamina() at the start of the move */
+	uint8 bConsumingStamina : 1;
+
+	/** With the rate model, whether the server can't reconstruct EndStamina from the segment */
+	uint8 bSendStamina : 1;
+
+	EStaminaSegment EndStaminaSegment;
 	float StartStamina;
 	float EndStamina;
 
@@ -192,4 +329,7 @@ public:
 	{}
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+protected:
+	TPredictedSavedMoveSlab<FSavedMove_Character_Stamina> MoveSlab;
 };
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "System/PredictedSavedMovePool.h"
 #include "StrafeMovement.generated.h"
 
 class AStrafeCharacter;
@@ -152,4 +153,7 @@ public:
 	{}
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+protected:
+	TPredictedSavedMoveSlab<FSavedMove_Character_Strafe> MoveSlab;
 };
@@ -0,0 +1,43 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+/**
+ * The compressed flags used by each shell, in one place so they don't collide when shells are merged into a single
+ * movement component. FLAG_Reserved_1 and FLAG_Reserved_2 belong to the engine and must not be used.
+ * Stamina and Modifiers are sent with their network move data instead of compressed flags.
+ */
+namespace PredictedMovementFlags
+{
+	static constexpr uint8 Sprint = FSavedMove_Character::FLAG_Custom_0;
+	static constexpr uint8 Prone = FSavedMove_Character::FLAG_Custom_1;
+
+	/** Breaking: Strafe previously used FLAG_Reserved_1, projects using FLAG_Custom_2 themselves must move to Free */
+	static constexpr uint8 Strafe = FSavedMove_Character::FLAG_Custom_2;
+
+	/** Every flag used by the shells */
+	static constexpr uint8 Used = Sprint | Prone | Strafe;
+
+	/** Free for your own project */
+	static constexpr uint8 Free = FSavedMove_Character::FLAG_Custom_3;
+
+	static_assert((Sprint & Prone) == 0 && (Sprint & Strafe) == 0 && (Prone & Strafe) == 0, "Compressed flags collide");
+	static_assert((Used & Free) == 0, "Compressed flags collide");
+	static_assert((Used & (FSavedMove_Character::FLAG_Reserved_1 | FSavedMove_Character::FLAG_Reserved_2)) == 0, "Compressed flags use engine reserved flags");
+
+	FORCEINLINE void Pack(uint8& Flags, bool bState, uint8 Flag)
+	{
+		if (bState)
+		{
+			Flags |= Flag;
+		}
+	}
+
+	FORCEINLINE bool Unpack(uint8 Flags, uint8 Flag)
+	{
+		return (Flags & Flag) != 0;
+	}
+}
@@ -0,0 +1,71 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ACharacter;
+
+/**
+ * Level of detail for simulated proxies, opt-in with p.PredictedMovement.ProxyLOD
+ * Replicated state changes of a proxy that is distant or hasn't been rendered recently are coalesced, and the
+ * resulting events and capsule resizes are deferred until it is significant again
+ */
+namespace PredictedMovementSignificance
+{
+	/** @return True if Character is a simulated proxy whose replicated state changes should be deferred */
+	PREDICTEDMOVEMENT_API bool ShouldDeferSimulatedProxy(const ACharacter* Character);
+}
+
+/**
+ * A simulated proxy's replicated bool state, e.g. bIsProned, while its change is deferred
+ * Only the latest state is applied, and nothing is applied if it changed back in the meantime
+ */
+struct FPredictedProxyDeferredState
+{
+	/** The state that was last applied */
+	bool bAppliedState = false;
+	bool bPending = false;
+
+	/**
+	 * Call from the OnRep
+	 * @return True if NewState should be applied now
+	 */
+	bool OnRep(const ACharacter* Character, bool bNewState)
+	{
+		if (PredictedMovementSignificance::ShouldDeferSimulatedProxy(Character))
+		{
+			if (!bPending)
+			{
+				bPending = true;
+				bAppliedState = !bNewState;
+			}
+			return false;
+		}
+
+		// Significant again before flushing, and it changed back to what was applied
+		if (bPending && bAppliedState == bNewState)
+		{
+			bPending = false;
+			return false;
+		}
+
+		bPending = false;
+		return true;
+	}
+
+	/**
+	 * Call while pending, e.g. from SimulatedTick
+	 * @return True if NewState should be applied now
+	 */
+	bool Flush(const ACharacter* Character, bool bNewState)
+	{
+		if (!bPending || PredictedMovementSignificance::ShouldDeferSimulatedProxy(Character))
+		{
+			return false;
+		}
+
+		bPending = false;
+		return bNewState != bAppliedState;
+	}
+};
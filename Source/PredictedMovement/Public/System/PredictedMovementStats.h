@@ -0,0 +1,125 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_STATS_GROUP(TEXT("PredictedMovement"), STATGROUP_PredictedMovement, STATCAT_Advanced);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(PREDICTEDMOVEMENT_API, PredictedMovement);
+
+/** Which check caused the server to correct the client */
+enum class EPredictedCorrectionCause : uint8
+{
+	Movement,			// UCharacterMovementComponent::ServerCheckClientError, e.g. location
+	Modifier,			// A corrected modifier stack differs, e.g. BoostCorrection
+	Stamina,			// Stamina differs by more than NetworkStaminaCorrectionThreshold
+	StaminaSegment,		// Stamina rate model segment differs
+	Num
+};
+
+/** What is being serialized, for bandwidth per feature */
+enum class EPredictedNetFeature : uint8
+{
+	ModifierMoveData,
+	ModifierMoveResponse,
+	StaminaMoveData,
+	StaminaMoveResponse,
+	Num
+};
+
+/** Why a saved move's CanCombineWith did or didn't combine the moves */
+enum class EPredictedCombineResult : uint8
+{
+	Combined,
+	CombinedRelaxed,			// Only combined because of EModifierCombinePolicy::Relaxed
+	RejectedBase,				// FSavedMove_Character::CanCombineWith rejected it, e.g. acceleration or delta time
+	RejectedWantsModifiers,		// WantsModifiers differ
+	RejectedModifierLevels,		// Modifier levels differ
+	RejectedStaminaConsuming,	// Stamina rate model consumption differs
+	RejectedStaminaDrained,		// Stamina drained state differs
+	Num
+};
+
+/** The result of UModifierMovement::ServerShouldGrantClientPositionAuthority */
+enum class EPredictedClientAuthOutcome : uint8
+{
+	Full,
+	Partial,
+	Rejected,
+	Num
+};
+
+/**
+ * Lightweight counters for corrections, bandwidth, client authority and move combining, enable with p.PredictedMovement.Stats
+ * Reported to 'stat PredictedMovement' and the CSV profiler, and totals are printed by p.PredictedMovement.Stats.Dump
+ * so they can be queried on live servers without Insights
+ */
+namespace PredictedMovementStats
+{
+	PREDICTEDMOVEMENT_API bool IsEnabled();
+
+	/**
+	 * @param Cause The check that failed
+	 * @param Detail Optional name of what failed, e.g. the modifier slot name
+	 */
+	PREDICTEDMOVEMENT_API void RecordCorrection(EPredictedCorrectionCause Cause, const TCHAR* Detail = nullptr);
+
+	PREDICTEDMOVEMENT_API void RecordSerializedBits(EPredictedNetFeature Feature, int64 NumBits);
+
+	PREDICTEDMOVEMENT_API void RecordClientAuth(EPredictedClientAuthOutcome Outcome);
+
+	/** Moves combined and why they weren't, to measure the send rate reduction of move combining */
+	PREDICTEDMOVEMENT_API void RecordCombine(EPredictedCombineResult Result);
+
+	/**
+	 * @return The number of bits written to a net archive, or INDEX_NONE if it isn't a net archive being saved
+	 * within FPredictedMovementScopedNetWriter, where it is known to be the engine's FNetBitWriter
+	 */
+	PREDICTEDMOVEMENT_API int64 GetSerializedBits(const FArchive& Ar);
+
+	/** @see FPredictedMovementScopedNetWriter */
+	PREDICTEDMOVEMENT_API void PushNetWriter();
+	PREDICTEDMOVEMENT_API void PopNetWriter();
+
+	PREDICTEDMOVEMENT_API void Reset();
+	PREDICTEDMOVEMENT_API void Dump(FOutputDevice& Ar);
+
+	/** @return The totals as a JSON object, for tracking regressions */
+	PREDICTEDMOVEMENT_API FString ToJson();
+}
+
+/**
+ * Declares that moves or move responses serialized within scope are written by the engine's FNetBitWriter
+ * e.g. around CallServerMovePacked and ServerSendMoveResponse, any other archive is not measured
+ */
+struct FPredictedMovementScopedNetWriter
+{
+	FPredictedMovementScopedNetWriter() { PredictedMovementStats::PushNetWriter(); }
+	~FPredictedMovementScopedNetWriter() { PredictedMovementStats::PopNetWriter(); }
+};
+
+/** Records the bits a feature writes to a net archive within scope */
+struct FPredictedMovementScopedNetBits
+{
+	FPredictedMovementScopedNetBits(const FArchive& InAr, EPredictedNetFeature InFeature)
+		: Ar(InAr)
+		, Feature(InFeature)
+		, StartBits(PredictedMovementStats::IsEnabled() ? PredictedMovementStats::GetSerializedBits(InAr) : INDEX_NONE)
+	{}
+
+	~FPredictedMovementScopedNetBits()
+	{
+		if (StartBits != INDEX_NONE)
+		{
+			PredictedMovementStats::RecordSerializedBits(Feature, PredictedMovementStats::GetSerializedBits(Ar) - StartBits);
+		}
+	}
+
+private:
+	const FArchive& Ar;
+	EPredictedNetFeature Feature;
+	int64 StartBits;
+};
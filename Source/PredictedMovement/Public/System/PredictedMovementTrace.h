@@ -0,0 +1,93 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "System/PredictedMovementStats.h"
+
+#ifndef PREDICTED_MOVEMENT_TRACE_ENABLED
+#define PREDICTED_MOVEMENT_TRACE_ENABLED (UE_TRACE_ENABLED && !UE_BUILD_SHIPPING)
+#endif
+
+struct FGameplayTag;
+
+/** The saved move lifecycle step being traced */
+enum class EPredictedSavedMoveStep : uint8
+{
+	SetMoveFor,			// Client created the move from the current input
+	CombineWith,		// Client combined the pending move into this one
+	PostUpdateRecord,	// Client performed the move for the first time
+	PostUpdateReplay,	// Client replayed the move after a correction
+	PrepMoveFor,		// Client prepares to replay the move after a correction
+};
+
+/** Which prone transition was attempted */
+enum class EPredictedProneAttempt : uint8
+{
+	Prone,
+	UnProne,
+};
+
+/** The result of a prone transition attempt */
+enum class EPredictedProneResult : uint8
+{
+	Succeeded,
+	Encroached,			// Collision queries found the larger capsule doesn't fit
+	CachedEncroached,	// Skipped the collision queries, they already failed here
+	Locked,				// UnProne is prevented by the prone lock
+};
+
+/**
+ * Structured events on the PredictedMovement trace channel, for Unreal Insights
+ * Enable at runtime with 'Trace.Enable PredictedMovement', or on launch with -trace=default,PredictedMovement
+ * Nothing is evaluated while the channel is disabled, and nothing is compiled in shipping builds
+ */
+#if PREDICTED_MOVEMENT_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_EXTERN(PredictedMovementChannel, PREDICTEDMOVEMENT_API);
+
+namespace PredictedMovementTrace
+{
+	PREDICTEDMOVEMENT_API void OutputSavedMove(const UObject* Owner, EPredictedSavedMoveStep Step, float TimeStamp, float DeltaTime);
+	PREDICTEDMOVEMENT_API void OutputCombine(const UObject* Owner, EPredictedCombineResult Result, float TimeStamp);
+	PREDICTEDMOVEMENT_API void OutputCorrection(const UObject* Owner, EPredictedCorrectionCause Cause, const TCHAR* Detail, float TimeStamp);
+	PREDICTEDMOVEMENT_API void OutputClientAuthGrant(const UObject* Owner, const FGameplayTag& Source, float Duration, int32 Priority);
+	PREDICTEDMOVEMENT_API void OutputClientAuth(const UObject* Owner, EPredictedClientAuthOutcome Outcome, float Alpha, float Distance);
+	PREDICTEDMOVEMENT_API void OutputProneAttempt(const UObject* Owner, EPredictedProneAttempt Attempt, EPredictedProneResult Result, int32 NumQueries);
+}
+
+#define PREDICTED_MOVEMENT_TRACE(Func, ...) \
+	do \
+	{ \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(PredictedMovementChannel)) \
+		{ \
+			PredictedMovementTrace::Func(__VA_ARGS__); \
+		} \
+	} while (0)
+
+/** CPU timing of a predicted movement feature, only when both the Cpu and PredictedMovement channels are enabled */
+#define PREDICTED_MOVEMENT_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, PredictedMovementChannel)
+
+#else
+
+#define PREDICTED_MOVEMENT_TRACE(Func, ...) do {} while (0)
+#define PREDICTED_MOVEMENT_SCOPE(Name)
+
+#endif
+
+#define TRACE_PREDICTED_SAVED_MOVE(Owner, Step, TimeStamp, DeltaTime) PREDICTED_MOVEMENT_TRACE(OutputSavedMove, Owner, Step, TimeStamp, DeltaTime)
+#define TRACE_PREDICTED_COMBINE(Owner, Result, TimeStamp) PREDICTED_MOVEMENT_TRACE(OutputCombine, Owner, Result, TimeStamp)
+#define TRACE_PREDICTED_CORRECTION(Owner, Cause, Detail, TimeStamp) PREDICTED_MOVEMENT_TRACE(OutputCorrection, Owner, Cause, Detail, TimeStamp)
+#define TRACE_PREDICTED_CLIENT_AUTH_GRANT(Owner, Source, Duration, Priority) PREDICTED_MOVEMENT_TRACE(OutputClientAuthGrant, Owner, Source, Duration, Priority)
+#define TRACE_PREDICTED_CLIENT_AUTH(Owner, Outcome, Alpha, Distance) PREDICTED_MOVEMENT_TRACE(OutputClientAuth, Owner, Outcome, Alpha, Distance)
+#define TRACE_PREDICTED_PRONE_ATTEMPT(Owner, Attempt, Result, NumQueries) PREDICTED_MOVEMENT_TRACE(OutputProneAttempt, Owner, Attempt, Result, NumQueries)
+
+/** Record and trace a CanCombineWith decision, @return True if the moves combine */
+FORCEINLINE bool ReportPredictedCombine(const UObject* Owner, EPredictedCombineResult Result, float TimeStamp)
+{
+	PredictedMovementStats::RecordCombine(Result);
+	TRACE_PREDICTED_COMBINE(Owner, Result, TimeStamp);
+	return Result == EPredictedCombineResult::Combined || Result == EPredictedCombineResult::CombinedRelaxed;
+}
@@ -0,0 +1,53 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+/**
+ * Preconstructs the saved moves of FNetworkPredictionData_Client_Character in a single slab, call from AllocateNewMove()
+ *
+ * FNetworkPredictionData_Client_Character already recycles freed moves through FreeMoves, but allocates each on demand
+ * and discards any beyond MaxFreeMoveCount. The first allocation instead constructs MaxSavedMoveCount moves, plus
+ * the moves held outside of SavedMoves, contiguously and hands them to FreeMoves, so no move is allocated or freed
+ * while playing.
+ *
+ * Each move shares the slab's reference count, the slab is freed once the last move is released
+ */
+template<typename TSavedMove>
+struct TPredictedSavedMoveSlab
+{
+	/**
+	 * Moves held outside of SavedMoves: PendingMove, LastAckedMove and the new move being set up
+	 * A client at MaxSavedMoveCount still has these live, without them it would allocate every move
+	 */
+	static constexpr int32 NumExtraMoves = 3;
+
+	FSavedMovePtr Allocate(FNetworkPredictionData_Client_Character& ClientData)
+	{
+		// Every move of the slab is in use, the pool was exceeded
+		if (bAllocated)
+		{
+			return MakeShared<TSavedMove>();
+		}
+		bAllocated = true;
+
+		const int32 NumMoves = FMath::Max(0, ClientData.MaxSavedMoveCount) + NumExtraMoves;
+		ClientData.MaxFreeMoveCount = FMath::Max(ClientData.MaxFreeMoveCount, NumMoves);
+
+		// Never resized after this, the moves are referenced by address
+		TSharedRef<TArray<TSavedMove>> Slab = MakeShared<TArray<TSavedMove>>();
+		Slab->AddDefaulted(NumMoves);
+
+		ClientData.FreeMoves.Reserve(ClientData.FreeMoves.Num() + NumMoves - 1);
+		for (int32 i = NumMoves - 1; i > 0; --i)
+		{
+			ClientData.FreeMoves.Add(FSavedMovePtr(Slab, &(*Slab)[i]));
+		}
+		return FSavedMovePtr(Slab, &(*Slab)[0]);
+	}
+
+private:
+	bool bAllocated = false;
+};
@@ -0,0 +1,66 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PredictedSimulatedState.generated.h"
+
+// The maximum number of levels, e.g. one per modifier family, carried by FPredictedSimulatedState
+#define MAX_SIMULATED_STATE_LEVELS 15
+
+/**
+ * Every modifier level a simulated proxy needs, packed into a single replicated property
+ * One replication handle, one comparison and one OnRep instead of one per family
+ * Levels are indices where UINT8_MAX is inactive, e.g. modifier levels
+ */
+USTRUCT()
+struct PREDICTEDMOVEMENT_API FPredictedSimulatedState
+{
+	GENERATED_BODY()
+
+	/** Level indices, UINT8_MAX if inactive */
+	TArray<uint8, TFixedAllocator<MAX_SIMULATED_STATE_LEVELS>> Levels;
+
+	uint8 GetLevel(int32 Index) const { return Levels.IsValidIndex(Index) ? Levels[Index] : UINT8_MAX; }
+
+	/** @return True if the level changed */
+	bool SetLevel(int32 Index, uint8 Level)
+	{
+		if (!ensure(Index >= 0 && Index < MAX_SIMULATED_STATE_LEVELS))
+		{
+			return false;
+		}
+
+		while (Levels.Num() <= Index)
+		{
+			Levels.Add(UINT8_MAX);
+		}
+
+		const bool bChanged = Levels[Index] != Level;
+		Levels[Index] = Level;
+		return bChanged;
+	}
+
+	/** The number of levels is packed to 4 bits and each level to a single bit if inactive, otherwise 9 bits */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FPredictedSimulatedState& Other) const
+	{
+		return Levels == Other.Levels;
+	}
+
+	bool operator!=(const FPredictedSimulatedState& Other) const
+	{
+		return !(*this == Other);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FPredictedSimulatedState> : public TStructOpsTypeTraitsBase2<FPredictedSimulatedState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};